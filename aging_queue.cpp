@@ -0,0 +1,156 @@
+#include "aging_queue.h"
+
+#include <algorithm> // for std::min, std::max
+
+
+
+// higher key belongs closer to the root
+static bool higherAgingKey(const AgingKey &a, const AgingKey &b) {
+    return a.key > b.key;
+}
+
+
+
+// key that orders a job by its effective priority at any tick, see AgingQueue
+static long long agingKey(const AgingQueue &jobs, const AgingRecord &record) {
+    return record.priority - jobs.rate * record.arrival;
+}
+
+
+
+// helper for recording the new index of a key that was moved inside the heap
+static void keyPlaced(AgingQueue &jobs, int i) {
+    jobs.positions[jobs.heap[i].id] = i;
+}
+
+
+
+// free the name and id of a job whose key left the heap
+static void retireJob(AgingQueue &jobs, JobId id) {
+    AgingRecord &record = jobs.records[id];
+    jobs.jobIds.erase(record.name.text);
+    jobs.names.release(record.name);
+    record.name = NameRef();
+    jobs.positions[id] = -1;
+    jobs.freeIds.push_back(id);
+}
+
+
+
+bool pushJob(AgingQueue &jobs, std::string_view name, int priority) {
+    if (jobs.jobIds.find(name) != NameIndex::NOT_FOUND)
+        return false;
+
+    JobId id;
+    if (!jobs.freeIds.empty()) {
+        id = jobs.freeIds.back();
+        jobs.freeIds.pop_back();
+    } else {
+        id = static_cast<JobId>(jobs.records.size());
+        jobs.records.emplace_back();
+        jobs.positions.push_back(-1);
+    }
+
+    AgingRecord &record = jobs.records[id];
+    record.name = jobs.names.intern(name);
+    record.priority = priority;
+    record.arrival = jobs.epoch;
+    jobs.jobIds.insert(record.name.text, id);
+
+    jobs.heap.push_back({agingKey(jobs, record), id});
+    siftUp(jobs.heap, jobs.size() - 1, higherAgingKey, [&](int i) { keyPlaced(jobs, i); });
+    return true;
+}
+
+
+
+bool popJob(AgingQueue &jobs, PrintJob &job) {
+    if (jobs.empty())
+        return false;
+
+    AgingKey top = popTop(jobs.heap, higherAgingKey, [&](int i) { keyPlaced(jobs, i); });
+
+    const AgingRecord &record = jobs.records[top.id];
+    job.name.assign(record.name.text);
+    job.priority = record.priority;
+    retireJob(jobs, top.id);
+    return true;
+}
+
+
+
+bool peekJob(const AgingQueue &jobs, PrintJob &job) {
+    if (jobs.empty())
+        return false;
+
+    const AgingRecord &record = jobs.records[jobs.heap.front().id];
+    job.name.assign(record.name.text);
+    job.priority = record.priority;
+    return true;
+}
+
+
+
+bool changePriority(AgingQueue &jobs, std::string_view name, int new_priority) {
+    JobId id = jobs.jobIds.find(name);
+    if (id == NameIndex::NOT_FOUND)
+        return false;
+
+    AgingRecord &record = jobs.records[id];
+    int index = jobs.positions[id];
+    int old_priority = record.priority;
+    record.priority = new_priority;
+    jobs.heap[index].key = agingKey(jobs, record);
+
+    auto placed = [&](int i) { keyPlaced(jobs, i); };
+    if (new_priority > old_priority)
+        siftUp(jobs.heap, index, higherAgingKey, placed);
+    else
+        siftDown(jobs.heap, jobs.size(), index, higherAgingKey, placed);
+    return true;
+}
+
+
+
+bool removeJob(AgingQueue &jobs, std::string_view name) {
+    JobId id = jobs.jobIds.find(name);
+    if (id == NameIndex::NOT_FOUND)
+        return false;
+    int index = jobs.positions[id];
+
+    // the last key fills the hole, and goes up or down from there
+    AgingKey last = jobs.heap.back();
+    jobs.heap.pop_back();
+    if (index < jobs.size()) {
+        jobs.heap[index] = last;
+        auto placed = [&](int i) { keyPlaced(jobs, i); };
+        if (index > 0 && higherAgingKey(last, jobs.heap[DaryLayout<HEAP_ARITY>::parent(index)]))
+            siftUp(jobs.heap, index, higherAgingKey, placed);
+        else
+            siftDown(jobs.heap, jobs.size(), index, higherAgingKey, placed);
+    }
+
+    retireJob(jobs, id);
+    return true;
+}
+
+
+
+void reserveJobs(AgingQueue &jobs, int n) {
+    jobs.heap.reserve(n);
+    jobs.records.reserve(n);
+    jobs.positions.reserve(n);
+    jobs.jobIds.reserve(n);
+}
+
+
+
+std::vector<HeapKey> topK(const AgingQueue &jobs, int k) {
+    std::vector<HeapKey> keys;
+    keys.reserve(std::min(std::max(k, 0), jobs.size()));
+    visitTopK(jobs.heap, k, higherAgingKey, [&](int i) {
+        JobId id = jobs.heap[i].id;
+        keys.push_back({jobs.records[id].priority, id});
+    });
+    return keys;
+}
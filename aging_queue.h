@@ -0,0 +1,114 @@
+#ifndef MAXHEAP_AGING_QUEUE_H
+#define MAXHEAP_AGING_QUEUE_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "print_queue.h"
+
+
+
+// priority credit a waiting job earns per tick. the default can be changed at compile time,
+// e.g. with -DMAXHEAP_AGING_RATE=4 (or the MAXHEAP_AGING_RATE cmake cache variable)
+#ifndef MAXHEAP_AGING_RATE
+#define MAXHEAP_AGING_RATE 1
+#endif
+
+constexpr long long DEFAULT_AGING_RATE = MAXHEAP_AGING_RATE;
+
+static_assert(DEFAULT_AGING_RATE >= 0, "aging can't make waiting jobs less important");
+
+
+
+// what the aging heap stores. the key doesn't change while a job waits, see AgingQueue
+struct AgingKey {
+    long long key;
+    JobId id;
+};
+
+
+
+// everything about a job that the heap doesn't need for ordering, indexed by job id
+struct AgingRecord {
+    NameRef name;
+
+    // priority the job was submitted (or last updated) with, and the tick it arrived at
+    int priority = 0;
+    long long arrival = 0;
+};
+
+
+
+// print queue with aging, so low-priority jobs can't starve: every tick, every waiting job gains 'rate' priority.
+// a job's effective priority at tick t is priority + rate * (t - arrival). the rate * t part is the same for all
+// jobs, so it never changes their order, and the heap only needs to order them by priority - rate * arrival.
+// that key is fixed when the job arrives, so a tick is just one increment of the epoch counter, with nothing
+// re-keyed or re-heapified, no matter how many jobs are queued.
+//
+// offers the same operations as PrintQueue, see job_queue.h for picking one of them at compile time
+struct AgingQueue {
+    DaryHeap<AgingKey, HEAP_ARITY> heap;
+
+    std::vector<AgingRecord> records;
+    std::vector<int> positions;
+    std::vector<JobId> freeIds;
+
+    NameArena names;
+    NameIndex jobIds;
+
+    // current tick, and the credit per tick
+    long long epoch = 0;
+    long long rate;
+
+    explicit AgingQueue(long long rate = DEFAULT_AGING_RATE) : rate(rate) {}
+
+    bool empty() const { return heap.empty(); }
+    int size() const { return static_cast<int>(heap.size()); }
+};
+
+
+
+// name of the job a key returned by topK belongs to
+inline std::string_view jobName(const AgingQueue &jobs, const HeapKey &key) {
+    return jobs.records[key.id].name.text;
+}
+
+// priority of a queued job including the credit it has earned by waiting until now
+inline long long effectivePriority(const AgingQueue &jobs, JobId id) {
+    const AgingRecord &record = jobs.records[id];
+    return record.priority + jobs.rate * (jobs.epoch - record.arrival);
+}
+
+
+
+// let 'ticks' ticks pass. O(1), every queued job gains rate * ticks priority
+inline void advanceEpoch(AgingQueue &jobs, long long ticks = 1) {
+    jobs.epoch += ticks;
+}
+
+// add a job, arriving at the current tick. returns false (and changes nothing) if a job with that name is already queued
+bool pushJob(AgingQueue &jobs, std::string_view name, int priority);
+
+// remove the job with the highest effective priority into 'job', with the priority it was submitted with.
+// returns false if the queue is empty
+bool popJob(AgingQueue &jobs, PrintJob &job);
+
+// copy the job with the highest effective priority into 'job', without removing it. returns false if the queue is empty
+bool peekJob(const AgingQueue &jobs, PrintJob &job);
+
+// change the priority of a queued job. the job keeps the credit it earned so far.
+// returns false if no job with that name is queued
+bool changePriority(AgingQueue &jobs, std::string_view name, int new_priority);
+
+// remove a queued job, wherever it is in the heap, in O(log n). returns false if no job with that name is queued
+bool removeJob(AgingQueue &jobs, std::string_view name);
+
+// make room for 'n' queued jobs in total, so adding that many jobs doesn't reallocate
+void reserveJobs(AgingQueue &jobs, int n);
+
+// keys of the k jobs with the highest effective priority (or of all jobs, if there are fewer), highest first,
+// with the priorities they were submitted with. the heap is not touched, and the cost is O(k log k)
+std::vector<HeapKey> topK(const AgingQueue &jobs, int k);
+
+#endif // MAXHEAP_AGING_QUEUE_H
@@ -0,0 +1,133 @@
+#include "batch_reader.h"
+
+#include <cerrno>
+#include <charconv>  // for std::from_chars
+#include <cstring>   // for std::memchr, std::memmove
+#include <unistd.h>
+
+
+
+// split the next token off the front of 'text', skipping the blanks before it
+static std::string_view nextToken(std::string_view &text) {
+    std::size_t start = 0;
+    while (start < text.size() && (text[start] == ' ' || text[start] == '\t'))
+        start++;
+    std::size_t stop = start;
+    while (stop < text.size() && text[stop] != ' ' && text[stop] != '\t')
+        stop++;
+
+    std::string_view token = text.substr(start, stop - start);
+    text.remove_prefix(stop);
+    return token;
+}
+
+
+
+// parse a priority token. the whole token has to be a number that fits in an int
+static bool parsePriority(std::string_view token, int &priority) {
+    const char *last = token.data() + token.size();
+    auto [ptr, error] = std::from_chars(token.data(), last, priority);
+    return error == std::errc() && ptr == last && !token.empty();
+}
+
+
+
+// parse one line into 'command'. anything that doesn't fit its command's arguments exactly is Invalid
+static void parseCommand(std::string_view text, BatchCommand &command) {
+    command = BatchCommand();
+    std::string_view op = nextToken(text);
+    if (op.size() != 1)
+        return;
+
+    BatchCommand::Kind kind;
+    switch (op[0]) {
+        case 'I': case 'i': kind = BatchCommand::Insert; break;
+        case 'P': case 'p': kind = BatchCommand::Pop; break;
+        case 'U': case 'u': kind = BatchCommand::Update; break;
+        case 'C': case 'c': kind = BatchCommand::Cancel; break;
+        case 'S': case 's': kind = BatchCommand::Stats; break;
+        default: return;
+    }
+
+    if (kind != BatchCommand::Pop && kind != BatchCommand::Stats) {
+        command.name = nextToken(text);
+        if (command.name.empty())
+            return;
+    }
+    if (kind == BatchCommand::Insert || kind == BatchCommand::Update) {
+        if (!parsePriority(nextToken(text), command.priority))
+            return;
+    }
+
+    // nothing may follow the arguments
+    if (!nextToken(text).empty())
+        return;
+    command.kind = kind;
+}
+
+
+
+BatchReader::BatchReader(int fd) : fd(fd), buffer(BLOCK_SIZE) {}
+
+
+
+bool BatchReader::nextLine(std::string_view &text) {
+    std::size_t searched = begin;
+    while (true) {
+        const void *found = std::memchr(buffer.data() + searched, '\n', end - searched);
+        if (found != nullptr) {
+            std::size_t newline = static_cast<const char *>(found) - buffer.data();
+            text = std::string_view(buffer.data() + begin, newline - begin);
+            begin = newline + 1;
+            break;
+        }
+
+        // the last line doesn't need a newline
+        if (atEnd) {
+            if (begin == end)
+                return false;
+            text = std::string_view(buffer.data() + begin, end - begin);
+            begin = end;
+            break;
+        }
+
+        // move the start of the unfinished line to the front, and read the next block behind it
+        searched = end - begin;
+        std::memmove(buffer.data(), buffer.data() + begin, searched);
+        end = searched;
+        begin = 0;
+        if (buffer.size() - end < BLOCK_SIZE / 2)
+            buffer.resize(buffer.size() * 2);
+
+        ssize_t got = ::read(fd, buffer.data() + end, buffer.size() - end);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0) {
+            atEnd = true;
+            readError = got < 0;
+        } else {
+            end += static_cast<std::size_t>(got);
+        }
+    }
+
+    lineNumber++;
+    if (!text.empty() && text.back() == '\r')
+        text.remove_suffix(1);
+    return true;
+}
+
+
+
+bool BatchReader::next(BatchCommand &command) {
+    std::string_view text;
+    while (nextLine(text)) {
+        std::string_view rest = text;
+        std::string_view first = nextToken(rest);
+        if (first.empty() || first[0] == '#')
+            continue;
+
+        parseCommand(text, command);
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,65 @@
+#ifndef MAXHEAP_BATCH_READER_H
+#define MAXHEAP_BATCH_READER_H
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+
+
+// one command of a batch script
+struct BatchCommand {
+    enum Kind {
+        Insert,     // I name priority
+        Pop,        // P
+        Update,     // U name priority
+        Cancel,     // C name
+        Stats,      // S, print the operation statistics
+        Invalid,    // a line that isn't any of the above
+    };
+
+    Kind kind = Invalid;
+
+    // the name points into the reader's buffer, so it is only valid until the next command is read
+    std::string_view name;
+    int priority = 0;
+};
+
+
+
+// reads batch commands, one per line, from a file descriptor. the input is read in large blocks and every line is
+// split and parsed in place, with std::from_chars for the numbers, so nothing is copied or allocated per command.
+// empty lines and lines starting with '#' are skipped. tokens are separated by spaces or tabs
+class BatchReader {
+public:
+    // bytes read at a time. a line longer than this makes the buffer grow
+    static constexpr std::size_t BLOCK_SIZE = 1 << 20;
+
+    explicit BatchReader(int fd);
+
+    // read the next command. returns false at the end of the input, or if reading failed
+    bool next(BatchCommand &command);
+
+    // number of the line the last command came from, starting at 1
+    long line() const { return lineNumber; }
+
+    // true if the input ended because of a read error
+    bool failed() const { return readError; }
+
+private:
+    // the next line without its newline, or false at the end of the input
+    bool nextLine(std::string_view &text);
+
+    int fd;
+    std::vector<char> buffer;
+
+    // unread part of the buffer
+    std::size_t begin = 0;
+    std::size_t end = 0;
+
+    bool atEnd = false;
+    bool readError = false;
+    long lineNumber = 0;
+};
+
+#endif // MAXHEAP_BATCH_READER_H
@@ -0,0 +1,1085 @@
+#include <iostream>                     // throughput benchmark for the heap engine
+#include <algorithm> // for std::sort, std::clamp, std::shuffle
+#include <atomic>
+#include <charconv>  // for std::from_chars, std::to_chars
+#include <chrono>
+#include <cmath>     // for std::pow
+#include <cstdlib>   // for std::strtol
+#include <filesystem>
+#include <fstream>
+#include <iomanip>   // for std::setprecision
+#include <mutex>
+#include <queue>     // for std::priority_queue
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "print_job.h"
+#include "print_queue.h"
+#include "concurrent_queue.h"
+#include "multi_queue.h"
+#include "submission_ring.h"
+#include "combining_queue.h"
+#include "pairing_queue.h"
+#include "bucket_queue.h"
+#include "bounded_queue.h"
+#include "aging_queue.h"
+#include "job_log.h"
+#include "job_queue.h"
+#include "snapshot.h"
+#include "mapped_queue.h"
+#include "op_stats.h"
+
+
+
+// clock used for all measurements
+using BenchClock = std::chrono::steady_clock;
+
+
+
+// millions of operations per second for 'ops' operations that took 'elapsed'
+double mopsPerSecond(long long ops, BenchClock::duration elapsed) {
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    return seconds > 0 ? ops / seconds / 1e6 : 0.0;
+}
+
+
+
+// fill a heap of the given arity with 'input' one insert at a time, then pop everything,
+// and print the insert and pop throughput
+template<int Arity, typename T>
+void benchArity(const std::vector<T> &input) {
+    DaryHeap<T, Arity> heap;
+    heap.reserve(input.size());
+    auto noPositions = [](int) {};
+    auto higher = [](const T &a, const T &b) { return a.priority > b.priority; };
+    long long checksum = 0;
+
+    auto insertStart = BenchClock::now();
+    for (const auto &job : input) {
+        heap.push_back(job);
+        siftUp(heap, static_cast<int>(heap.size() - 1), higher, noPositions);
+    }
+    auto insertTime = BenchClock::now() - insertStart;
+
+    auto popStart = BenchClock::now();
+    while (!heap.empty()) {
+        checksum += popTop(heap, higher, noPositions).priority;
+    }
+    auto popTime = BenchClock::now() - popStart;
+
+    std::cout << "arity " << Arity
+              << "\tinsert " << mopsPerSecond(static_cast<long long>(input.size()), insertTime) << " Mops/s"
+              << "\tpop " << mopsPerSecond(static_cast<long long>(input.size()), popTime) << " Mops/s"
+              << "\t(checksum " << checksum << ")" << std::endl;
+}
+
+
+
+// push every job into a PrintQueue and pop them all again, and print the throughput of both.
+// this includes the duplicate check, name storage and position bookkeeping of the real queue
+void benchQueue(const std::vector<PrintJob> &input) {
+    PrintQueue queue;
+    PrintJob job;
+    long long checksum = 0;
+
+    // two rounds, so the second one shows the cost once the queue's storage has been reused
+    for (int round = 1; round <= 2; round++) {
+        auto pushStart = BenchClock::now();
+        for (const auto &next : input)
+            pushJob(queue, next.name, next.priority);
+        auto pushTime = BenchClock::now() - pushStart;
+
+        auto popStart = BenchClock::now();
+        while (popJob(queue, job))
+            checksum += job.priority;
+        auto popTime = BenchClock::now() - popStart;
+
+        std::cout << "round " << round
+                  << "\tpush " << mopsPerSecond(static_cast<long long>(input.size()), pushTime) << " Mops/s"
+                  << "\tpop " << mopsPerSecond(static_cast<long long>(input.size()), popTime) << " Mops/s"
+                  << "\t(checksum " << checksum << ")" << std::endl;
+    }
+}
+
+
+
+// load all jobs into an empty PrintQueue with one insertBatch call, and print the throughput
+void benchBulkLoad(const std::vector<PrintJob> &input) {
+    PrintQueue queue;
+
+    auto start = BenchClock::now();
+    int added = insertBatch(queue, input);
+    auto elapsed = BenchClock::now() - start;
+
+    std::cout << "insertBatch\t" << mopsPerSecond(added, elapsed) << " Mops/s"
+              << "\t(" << added << " jobs)" << std::endl;
+}
+
+
+
+// drain a full PrintQueue in batches of k jobs, and print the throughput in jobs per second
+void benchPopBatch(const std::vector<PrintJob> &input, int k) {
+    PrintQueue queue;
+    insertBatch(queue, input);
+    long long checksum = 0;
+
+    auto start = BenchClock::now();
+    while (popBatch(queue, k, [&](std::string_view, int priority) { checksum += priority; }) > 0) {}
+    auto elapsed = BenchClock::now() - start;
+
+    std::cout << "popBatch k=" << k << "\t" << mopsPerSecond(static_cast<long long>(input.size()), elapsed) << " Mjobs/s"
+              << "\t(checksum " << checksum << ")" << std::endl;
+}
+
+
+
+// one step of a single-threaded trace: insert job 'job' of the input, pop, or set the priority of job 'job'
+struct TraceOp {
+    enum Kind { Insert, Pop, Update } kind;
+    int job;
+    int priority;
+};
+
+
+
+// mostly inserts: every job of the input is inserted, with a pop after every fourth insert
+std::vector<TraceOp> insertHeavyTrace(const std::vector<PrintJob> &input) {
+    std::vector<TraceOp> trace;
+    for (int i = 0; i < static_cast<int>(input.size()); i++) {
+        trace.push_back({TraceOp::Insert, i, input[i].priority});
+        if (i % 4 == 3)
+            trace.push_back({TraceOp::Pop, 0, 0});
+    }
+    return trace;
+}
+
+
+
+// mostly priority changes: a tenth of the input is queued, then every step changes the priority of a random
+// job by up to 'maxChange', three out of four times upward (jobs getting bumped while they wait), staying
+// within 'lowest' ... 'highest'. every tenth step prints a job
+// and submits a new one. the trace doesn't know which job a pop takes, so now and then an update hits a
+// job that was already printed, which costs both backends the same failed lookup
+std::vector<TraceOp> updateHeavyTrace(const std::vector<PrintJob> &input, std::mt19937 &rng, int maxChange, int lowest, int highest) {
+    std::vector<TraceOp> trace;
+    std::vector<int> priorities;
+    std::vector<int> targets;
+    int next = 0;
+    for (; next < static_cast<int>(input.size() / 10); next++) {
+        trace.push_back({TraceOp::Insert, next, input[next].priority});
+        priorities.push_back(input[next].priority);
+        targets.push_back(next);
+    }
+    if (targets.empty())
+        return trace;
+
+    for (long step = 0; step < static_cast<long>(input.size()); step++) {
+        std::size_t target = rng() % targets.size();
+        if (step % 10 == 9 && next < static_cast<int>(input.size())) {
+            trace.push_back({TraceOp::Pop, 0, 0});
+            trace.push_back({TraceOp::Insert, next, input[next].priority});
+            priorities.push_back(input[next].priority);
+            targets[target] = next++;
+            continue;
+        }
+        int job = targets[target];
+        int change = static_cast<int>(rng() % (maxChange + 1));
+        priorities[job] = std::clamp(priorities[job] + (rng() % 4 != 0 ? change : -change), lowest, highest);
+        trace.push_back({TraceOp::Update, job, priorities[job]});
+    }
+    return trace;
+}
+
+
+
+// run a trace against a fresh queue of any backend, and print the throughput in trace steps per second
+template<typename Queue, typename... QueueArgs>
+void benchTrace(const char *label, const std::vector<PrintJob> &input, const std::vector<TraceOp> &trace, QueueArgs... queueArgs) {
+    Queue queue(queueArgs...);
+    PrintJob job;
+    long long checksum = 0;
+
+    auto start = BenchClock::now();
+    for (const auto &op : trace) {
+        switch (op.kind) {
+            case TraceOp::Insert:
+                pushJob(queue, input[op.job].name, op.priority);
+                break;
+            case TraceOp::Pop:
+                if (popJob(queue, job))
+                    checksum += job.priority;
+                break;
+            case TraceOp::Update:
+                changePriority(queue, input[op.job].name, op.priority);
+                break;
+        }
+    }
+    auto elapsed = BenchClock::now() - start;
+
+    std::cout << label << "	" << mopsPerSecond(static_cast<long long>(trace.size()), elapsed) << " Mops/s"
+              << "	(" << queue.size() << " left, checksum " << checksum << ")" << std::endl;
+}
+
+
+
+// steady state under load: a tenth of the input is queued up front, then every step submits one job and prints one.
+// a queue with aging gets one tick per printed job. prints the throughput, the longest wait of a printed job
+// (in printed jobs), and how many of the jobs queued up front were never printed at all
+template<typename Queue>
+void benchStarvation(const char *label, const std::vector<PrintJob> &input) {
+    Queue queue;
+    PrintJob job;
+    long queued = static_cast<long>(input.size() / 10);
+    std::vector<long> submitted(input.size(), 0);
+    for (long i = 0; i < queued; i++)
+        pushJob(queue, input[i].name, input[i].priority);
+
+    long maxWait = 0;
+    long printedEarly = 0;
+    auto start = BenchClock::now();
+    for (long step = queued; step < static_cast<long>(input.size()); step++) {
+        submitted[step] = step;
+        pushJob(queue, input[step].name, input[step].priority);
+        popJob(queue, job);
+        if constexpr (requires { advanceEpoch(queue); })
+            advanceEpoch(queue);
+
+        // the index of a job is in its name, "job<index>"
+        long index = 0;
+        std::from_chars(job.name.data() + 3, job.name.data() + job.name.size(), index);
+        maxWait = std::max(maxWait, step - submitted[index]);
+        if (index < queued)
+            printedEarly++;
+    }
+    auto elapsed = BenchClock::now() - start;
+
+    std::cout << label << "	" << mopsPerSecond(2 * (static_cast<long long>(input.size()) - queued), elapsed) << " Mops/s"
+              << "	longest wait " << maxWait << "	never printed " << queued - printedEarly << " of " << queued << std::endl;
+}
+
+
+
+// cancellation storm: a full queue has a share of its jobs cancelled in random order, and is then drained.
+// 'maxCancelledShare' 0 removes every job right away, anything else cancels lazily. prints the throughput of both phases
+void benchCancel(const std::vector<PrintJob> &input, double cancelShare, double maxCancelledShare) {
+    PrintQueue queue;
+    queue.maxCancelledShare = maxCancelledShare;
+    insertBatch(queue, input);
+
+    std::vector<int> order(input.size());
+    for (std::size_t i = 0; i < order.size(); i++)
+        order[i] = static_cast<int>(i);
+    std::shuffle(order.begin(), order.end(), std::mt19937(7));
+    order.resize(static_cast<std::size_t>(cancelShare * order.size()));
+
+    auto cancelStart = BenchClock::now();
+    for (int i : order)
+        cancelJob(queue, input[i].name);
+    auto cancelTime = BenchClock::now() - cancelStart;
+
+    PrintJob job;
+    long long printed = 0;
+    auto drainStart = BenchClock::now();
+    while (popJob(queue, job))
+        printed++;
+    auto drainTime = BenchClock::now() - drainStart;
+
+    if (maxCancelledShare > 0)
+        std::cout << "lazy, compact at " << maxCancelledShare;
+    else
+        std::cout << "eager";
+    std::cout << "\tcancel " << mopsPerSecond(static_cast<long long>(order.size()), cancelTime) << " Mops/s"
+              << "\tdrain " << mopsPerSecond(printed, drainTime) << " Mops/s" << std::endl;
+}
+
+
+
+// 'threads' threads each log 'perThread' inserts, waiting for every one of them to be durable,
+// and print the throughput and how many records each sync covered on average
+void benchLogCommit(const std::string &path, int threads, long perThread) {
+    std::filesystem::remove(path);
+    JobLog log;
+    if (!log.open(path)) {
+        std::cout << "can't open " << path << std::endl;
+        return;
+    }
+
+    auto start = BenchClock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            std::string name = "t" + std::to_string(t) + "-";
+            for (long i = 0; i < perThread; i++)
+                log.commit(log.append(LogOp::Insert, name + std::to_string(i), static_cast<int>(i)));
+        });
+    }
+    for (auto &worker : workers)
+        worker.join();
+    auto elapsed = BenchClock::now() - start;
+
+    double perSync = log.syncCount() ? static_cast<double>(log.appendCount()) / log.syncCount() : 0.0;
+    std::cout << "threads " << threads << "\t" << mopsPerSecond(perThread * threads, elapsed) * 1e3 << " kops/s"
+              << "\t" << perSync << " records/sync" << std::endl;
+    log.close();
+    std::filesystem::remove(path);
+}
+
+
+
+// write a log of every job being submitted and half of them printed, then time rebuilding the queue from it,
+// once with one insertBatch and once by pushing every recovered job on its own
+void benchLogRecovery(const std::string &path, const std::vector<PrintJob> &input) {
+    std::filesystem::remove(path);
+    {
+        JobLog log;
+        log.open(path);
+        for (const auto &job : input)
+            log.append(LogOp::Insert, job.name, job.priority);
+        for (std::size_t i = 0; i < input.size(); i += 2)
+            log.append(LogOp::Pop, input[i].name, input[i].priority);
+        log.commit(log.appendCount());
+    }
+
+    std::vector<PrintJob> recovered;
+    auto readStart = BenchClock::now();
+    readJobLog(path, recovered);
+    auto readTime = BenchClock::now() - readStart;
+
+    PrintQueue bulk;
+    auto bulkStart = BenchClock::now();
+    loadJobs(bulk, recovered);
+    auto bulkTime = BenchClock::now() - bulkStart;
+
+    PrintQueue single;
+    auto singleStart = BenchClock::now();
+    for (const auto &job : recovered)
+        pushJob(single, job.name, job.priority);
+    auto singleTime = BenchClock::now() - singleStart;
+
+    auto millis = [](BenchClock::duration elapsed) { return std::chrono::duration<double, std::milli>(elapsed).count(); };
+    std::cout << "recover " << bulk.size() << " jobs from " << std::filesystem::file_size(path) / (1024 * 1024) << " MiB"
+              << "\treplay log " << millis(readTime) << " ms"
+              << "\tinsertBatch " << millis(bulkTime) << " ms"
+              << "\tone push per job " << millis(singleTime) << " ms" << std::endl;
+    std::filesystem::remove(path);
+}
+
+
+
+// snapshot a queue of 'input', then time starting up from the snapshot against building the same queue
+// with one insertBatch and by pushing every job on its own
+void benchSnapshot(const std::string &path, const std::vector<PrintJob> &input) {
+    PrintQueue queued;
+    insertBatch(queued, input);
+
+    auto saveStart = BenchClock::now();
+    bool saved = saveSnapshot(queued, path, 1);
+    auto saveTime = BenchClock::now() - saveStart;
+    if (!saved) {
+        std::cout << "can't write " << path << std::endl;
+        return;
+    }
+
+    PrintQueue loaded;
+    std::uint32_t generation;
+    auto loadStart = BenchClock::now();
+    loadSnapshot(loaded, path, generation);
+    auto loadTime = BenchClock::now() - loadStart;
+
+    PrintQueue bulk;
+    auto bulkStart = BenchClock::now();
+    insertBatch(bulk, input);
+    auto bulkTime = BenchClock::now() - bulkStart;
+
+    PrintQueue single;
+    auto singleStart = BenchClock::now();
+    for (const auto &job : input)
+        pushJob(single, job.name, job.priority);
+    auto singleTime = BenchClock::now() - singleStart;
+
+    auto millis = [](BenchClock::duration elapsed) { return std::chrono::duration<double, std::milli>(elapsed).count(); };
+    std::cout << "start with " << loaded.size() << " jobs, " << std::filesystem::file_size(path) / (1024 * 1024) << " MiB"
+              << "\tsave " << millis(saveTime) << " ms"
+              << "\tload " << millis(loadTime) << " ms"
+              << "\tinsertBatch " << millis(bulkTime) << " ms"
+              << "\tone push per job " << millis(singleTime) << " ms" << std::endl;
+    std::filesystem::remove(path);
+}
+
+
+
+// log every job being submitted and half of them printed, twice: once as one long log, and once with a snapshot
+// taken before the last tenth of the records. then time recovering the same queue from both
+void benchSnapshotRecovery(const std::string &path, const std::vector<PrintJob> &input) {
+    std::string snapshot = path + ".snapshot";
+    std::uint64_t records = input.size() + (input.size() + 1) / 2;
+    std::uint64_t tail = records / 10;
+
+    // 'withSnapshot' keeps the queue alongside the log and snapshots it once only 'tail' records are left
+    auto writeLog = [&](bool withSnapshot) {
+        std::filesystem::remove(path);
+        std::filesystem::remove(snapshot);
+        JobLog log;
+        log.open(path);
+        PrintQueue queued;
+        auto logged = [&] {
+            if (withSnapshot && log.appendCount() == records - tail && log.markSnapshot()) {
+                saveSnapshot(queued, snapshot, log.snapshotGeneration());
+                log.restart();
+            }
+        };
+        for (const auto &job : input) {
+            log.append(LogOp::Insert, job.name, job.priority);
+            if (withSnapshot)
+                pushJob(queued, job.name, job.priority);
+            logged();
+        }
+        for (std::size_t i = 0; i < input.size(); i += 2) {
+            log.append(LogOp::Pop, input[i].name, input[i].priority);
+            if (withSnapshot)
+                removeJob(queued, input[i].name);
+            logged();
+        }
+        log.commit(log.appendCount());
+    };
+
+    writeLog(false);
+    PrintQueue whole;
+    auto wholeStart = BenchClock::now();
+    std::vector<PrintJob> recovered;
+    readJobLog(path, recovered);
+    loadJobs(whole, recovered);
+    auto wholeTime = BenchClock::now() - wholeStart;
+
+    writeLog(true);
+    PrintQueue fromSnapshot;
+    auto snapshotStart = BenchClock::now();
+    std::uint32_t generation;
+    std::vector<LogChange> changes;
+    bool ok = loadSnapshot(fromSnapshot, snapshot, generation) && readJobLogTail(path, generation, changes);
+    applyLogChanges(fromSnapshot, changes);
+    auto snapshotTime = BenchClock::now() - snapshotStart;
+
+    auto millis = [](BenchClock::duration elapsed) { return std::chrono::duration<double, std::milli>(elapsed).count(); };
+    std::cout << "recover " << whole.size() << " jobs after " << records << " records"
+              << "\twhole log " << millis(wholeTime) << " ms"
+              << "\tsnapshot and last " << tail << " records " << millis(snapshotTime) << " ms";
+    if (!ok || fromSnapshot.size() != whole.size())
+        std::cout << "\t(recovered " << fromSnapshot.size() << " jobs from the snapshot instead)";
+    std::cout << std::endl;
+    std::filesystem::remove(path);
+    std::filesystem::remove(snapshot);
+}
+
+
+
+// fill a mapped queue with 'input' and checkpoint it, then time reopening it and printing its first jobs,
+// which only touches the pages those jobs are on
+void benchMapped(const std::string &path, const std::vector<PrintJob> &input) {
+    auto removeFiles = [&] {
+        for (const char *suffix : {".heap", ".jobs", ".index", ".names"})
+            std::filesystem::remove(path + suffix);
+    };
+    removeFiles();
+
+    auto millis = [](BenchClock::duration elapsed) { return std::chrono::duration<double, std::milli>(elapsed).count(); };
+    {
+        MappedQueue jobs(path);
+        if (!jobs.isOpen()) {
+            std::cout << "can't map " << path << std::endl;
+            return;
+        }
+
+        auto fillStart = BenchClock::now();
+        reserveJobs(jobs, static_cast<int>(input.size()));
+        for (const auto &job : input)
+            pushJob(jobs, job.name, job.priority);
+        auto fillTime = BenchClock::now() - fillStart;
+
+        auto checkpointStart = BenchClock::now();
+        checkpointJobs(jobs);
+        auto checkpointTime = BenchClock::now() - checkpointStart;
+        std::cout << "push " << input.size() << " jobs " << mopsPerSecond(static_cast<long long>(input.size()), fillTime) << " Mops/s"
+                  << "\tcheckpoint " << millis(checkpointTime) << " ms" << std::endl;
+    }
+
+    auto openStart = BenchClock::now();
+    MappedQueue jobs(path);
+    auto openTime = BenchClock::now() - openStart;
+
+    const int printed = 1000;
+    PrintJob job;
+    long long checksum = 0;
+    auto popStart = BenchClock::now();
+    for (int i = 0; i < printed && popJob(jobs, job); i++)
+        checksum += job.priority;
+    auto popTime = BenchClock::now() - popStart;
+
+    std::cout << "reopen with " << jobs.size() + printed << " jobs " << millis(openTime) << " ms"
+              << "\tfirst " << printed << " pops " << millis(popTime) << " ms"
+              << "\t(checksum " << checksum << ")" << std::endl;
+    closeJobs(jobs);
+    removeFiles();
+}
+
+
+
+// the simplest thread-safe queue, as a baseline: one lock around the whole PrintQueue
+struct GlobalLockQueue {
+    std::mutex lock;
+    PrintQueue queue;
+
+    bool insert(std::string_view name, int priority) {
+        std::lock_guard<std::mutex> guard(lock);
+        return pushJob(queue, name, priority);
+    }
+
+    bool tryPop(PrintJob &job) {
+        std::lock_guard<std::mutex> guard(lock);
+        return popJob(queue, job);
+    }
+};
+
+
+
+// run 'threads' threads against a queue that starts with 'prefill' jobs. every thread submits its share of
+// 'ops' jobs and pops one job after every submit, like submitters and printers sharing the queue.
+// prints the total throughput in operations (submits + pops) per second
+template<typename Queue, typename... QueueArgs>
+void benchThreads(const char *label, int threads, long prefill, long ops, QueueArgs... queueArgs) {
+    Queue queue(queueArgs...);
+    for (long i = 0; i < prefill; i++)
+        queue.insert("pre" + std::to_string(i), static_cast<int>((i * 7919) % 1000000));
+
+    // names are made up front, so the threads only measure the queue
+    long perThread = ops / threads;
+    std::vector<std::vector<std::string>> names(threads);
+    for (int t = 0; t < threads; t++) {
+        names[t].reserve(perThread);
+        for (long i = 0; i < perThread; i++)
+            names[t].push_back("t" + std::to_string(t) + "-" + std::to_string(i));
+    }
+
+    auto start = BenchClock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            std::mt19937 rng(t);
+            PrintJob job;
+            for (long i = 0; i < perThread; i++) {
+                queue.insert(names[t][i], static_cast<int>(rng() % 1000000));
+                queue.tryPop(job);
+            }
+        });
+    }
+    for (auto &worker : workers)
+        worker.join();
+    auto elapsed = BenchClock::now() - start;
+
+    std::cout << label << "\tthreads " << threads
+              << "\t" << mopsPerSecond(2 * perThread * threads, elapsed) << " Mops/s";
+
+    // relaxed queues also report how far from strict priority order they were
+    if constexpr (requires { queue.stats(); }) {
+        RelaxationStats stats = queue.stats();
+        std::cout << "\t(rank error avg " << stats.averageRankError() << ", max " << stats.maxRankError << ")";
+    }
+
+    // and combining queues how much work they batched up
+    if constexpr (requires { queue.batchCount(); }) {
+        double perBatch = queue.batchCount() ? 2.0 * perThread * threads / queue.batchCount() : 0.0;
+        std::cout << "\t(" << perBatch << " ops/batch, " << queue.eliminatedCount() << " insert/pop pairs eliminated)";
+    }
+    std::cout << std::endl;
+}
+
+
+
+// print the 50th, 99th and 99.9th percentile and the maximum of a list of latencies
+void printPercentiles(const char *label, std::vector<long long> &nanos) {
+    std::sort(nanos.begin(), nanos.end());
+    auto at = [&](double q) { return nanos[static_cast<std::size_t>(q * (nanos.size() - 1))]; };
+    std::cout << label << "\tp50 " << at(0.5) << " ns\tp99 " << at(0.99) << " ns\tp99.9 " << at(0.999)
+              << " ns\tmax " << nanos.back() << " ns" << std::endl;
+}
+
+
+
+// submit 'ops' jobs from 'producers' threads while one owner thread keeps merging and printing them,
+// and print the percentiles of how long a single submit took. with 'useRing' producers go through a
+// SubmissionRing, otherwise they insert into a PrintQueue under the same lock the owner pops with
+void benchIngest(int producers, long ops, bool useRing) {
+    PrintQueue queue;
+    std::mutex lock;
+    SubmissionRing ring(4096);
+    std::atomic<int> running{producers};
+
+    long perThread = ops / producers;
+    std::vector<std::vector<std::string>> names(producers);
+    for (int t = 0; t < producers; t++) {
+        for (long i = 0; i < perThread; i++)
+            names[t].push_back("t" + std::to_string(t) + "-" + std::to_string(i));
+    }
+
+    // the owner drains submissions and prints about as many jobs as came in
+    std::thread owner([&] {
+        std::vector<PrintJob> printed;
+        while (true) {
+            // read this first: once it is zero, every submission is already in the ring
+            bool finished = running.load() == 0;
+
+            int merged;
+            printed.clear();
+            if (useRing) {
+                merged = mergeSubmissions(queue, ring, 1024);
+                popBatch(queue, merged, printed);
+            } else {
+                std::lock_guard<std::mutex> guard(lock);
+                merged = popBatch(queue, 1024, printed);
+            }
+
+            if (merged == 0) {
+                if (finished)
+                    break;
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::vector<std::vector<long long>> latencies(producers);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < producers; t++) {
+        workers.emplace_back([&, t] {
+            std::mt19937 rng(t);
+            latencies[t].reserve(perThread);
+            for (long i = 0; i < perThread; i++) {
+                int priority = static_cast<int>(rng() % 1000000);
+                auto start = BenchClock::now();
+                if (useRing) {
+                    while (ring.tryPush(names[t][i], priority) == SubmissionRing::PushResult::Full)
+                        std::this_thread::yield();
+                } else {
+                    std::lock_guard<std::mutex> guard(lock);
+                    pushJob(queue, names[t][i], priority);
+                }
+                latencies[t].push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(BenchClock::now() - start).count());
+            }
+            running--;
+        });
+    }
+    for (auto &worker : workers)
+        worker.join();
+    owner.join();
+
+    std::vector<long long> all;
+    for (auto &list : latencies)
+        all.insert(all.end(), list.begin(), list.end());
+
+    std::string label = std::string(useRing ? "ring" : "locked insert") + ", producers " + std::to_string(producers);
+    printPercentiles(label.c_str(), all);
+}
+
+
+
+// priority distributions for the suite
+enum class Spread { Uniform, Skewed, Sorted, Duplicates };
+
+const char *spreadName(Spread spread) {
+    switch (spread) {
+        case Spread::Uniform: return "uniform";
+        case Spread::Skewed: return "skewed";
+        case Spread::Sorted: return "sorted";
+        case Spread::Duplicates: return "duplicates";
+    }
+    return "";
+}
+
+
+
+// priority of job i: uniform over 0-1000000, skewed so most jobs are near 0 and only a few are high,
+// ascending so every insert climbs all the way to the root, or one of only ten values
+int suitePriority(Spread spread, long i, std::mt19937 &rng) {
+    switch (spread) {
+        case Spread::Uniform:
+            return static_cast<int>(rng() % 1000001);
+        case Spread::Skewed:
+            return static_cast<int>(1000000 * std::pow(std::uniform_real_distribution<double>(0, 1)(rng), 8));
+        case Spread::Sorted:
+            return static_cast<int>(i);
+        case Spread::Duplicates:
+            return static_cast<int>(rng() % 10);
+    }
+    return 0;
+}
+
+
+
+// name of job i, formatted into 'buffer'. the suite makes names as it goes instead of keeping them all,
+// so the largest sizes fit in memory
+std::string_view suiteName(char (&buffer)[24], long i) {
+    buffer[0] = 'j';
+    buffer[1] = 'o';
+    buffer[2] = 'b';
+    auto result = std::to_chars(buffer + 3, buffer + sizeof(buffer), i);
+    return std::string_view(buffer, result.ptr - buffer);
+}
+
+
+
+// start measuring the peak resident set size from what the process uses now (linux only)
+void resetPeakMemory() {
+    std::ofstream("/proc/self/clear_refs") << "5";
+}
+
+
+
+// peak resident set size in MiB since the last resetPeakMemory, or 0 if it can't be read
+double peakMemoryMiB() {
+    std::ifstream status("/proc/self/status");
+    std::string field;
+    while (status >> field) {
+        if (field == "VmHWM:") {
+            long kib = 0;
+            status >> kib;
+            return kib / 1024.0;
+        }
+    }
+    return 0.0;
+}
+
+
+
+// print one operation of a suite line: time and comparisons per operation
+void printSuiteOp(const char *op, long long ops, BenchClock::duration elapsed, long long comparisons) {
+    double nanos = std::chrono::duration<double, std::nano>(elapsed).count();
+    std::cout << "\t" << op << " " << (ops ? nanos / ops : 0.0) << " ns " << (ops ? double(comparisons) / ops : 0.0) << " cmp";
+}
+
+
+
+// a priority change the suite makes: job 'job' gets 'priority'
+struct SuiteUpdate {
+    long job;
+    int priority;
+};
+
+// jobs in one screen of the listing, the way the menu shows it
+constexpr int SUITE_SCREEN = 20;
+
+
+
+// the menu's operations on a PrintQueue: insert every job, change priorities, list the top screen, print every job.
+// they are timed with statistics off. the comparisons are read from the queue's own work counters (see op_stats.h)
+// in a second, untimed run of the same operations with statistics on
+void suiteQueue(const std::vector<int> &priorities, const std::vector<SuiteUpdate> &updates, int displays) {
+    long n = static_cast<long>(priorities.size());
+    long long checksum = 0;
+
+    // insert, update, display and pop: how long each took in the timed run, and its comparisons in the counted one
+    constexpr int PHASES = 4;
+    BenchClock::duration times[PHASES];
+    long long comparisons[PHASES];
+
+    auto run = [&](bool counted) {
+        enableOpStats(counted);
+        char name[24];
+        PrintJob job;
+        PrintQueue queue;
+
+        int phase = 0;
+        auto start = BenchClock::now();
+        std::uint64_t before = workCounters.comparisons;
+        auto endPhase = [&] {
+            if (counted)
+                comparisons[phase] = static_cast<long long>(workCounters.comparisons - before);
+            else
+                times[phase] = BenchClock::now() - start;
+            phase++;
+            before = workCounters.comparisons;
+            start = BenchClock::now();
+        };
+
+        for (long i = 0; i < n; i++)
+            pushJob(queue, suiteName(name, i), priorities[i]);
+        endPhase();
+
+        for (const auto &update : updates)
+            changePriority(queue, suiteName(name, update.job), update.priority);
+        endPhase();
+
+        long long shown = 0;
+        for (int d = 0; d < displays; d++)
+            shown += topK(queue, SUITE_SCREEN).back().priority;
+        endPhase();
+
+        long long printed = 0;
+        while (popJob(queue, job))
+            printed += job.priority;
+        endPhase();
+
+        if (!counted)
+            checksum = shown + printed;
+        enableOpStats(false);
+    };
+
+    resetPeakMemory();
+    run(false);
+    double peak = peakMemoryMiB();
+    run(true);
+    resetOpStats();
+
+    std::cout << "d-ary heap, arity " << HEAP_ARITY;
+    printSuiteOp("insert", n, times[0], comparisons[0]);
+    printSuiteOp("update", static_cast<long long>(updates.size()), times[1], comparisons[1]);
+    printSuiteOp("display", displays, times[2], comparisons[2]);
+    printSuiteOp("pop", n, times[3], comparisons[3]);
+    std::cout << "\tpeak " << peak << " MiB\t(checksum " << checksum << ")" << std::endl;
+}
+
+
+
+// the reference: std::priority_queue of the same keys, which has no names and can only insert and pop
+void suiteBaseline(const std::vector<int> &priorities) {
+    long n = static_cast<long>(priorities.size());
+    long long checksum = 0;
+
+    resetPeakMemory();
+    auto lower = [](const HeapKey &a, const HeapKey &b) { return higherKey(b, a); };
+    std::priority_queue<HeapKey, std::vector<HeapKey>, decltype(lower)> queue(lower);
+
+    auto insertStart = BenchClock::now();
+    for (long i = 0; i < n; i++)
+        queue.push({priorities[i], static_cast<JobId>(i)});
+    auto insertTime = BenchClock::now() - insertStart;
+
+    auto popStart = BenchClock::now();
+    while (!queue.empty()) {
+        checksum += queue.top().priority;
+        queue.pop();
+    }
+    auto popTime = BenchClock::now() - popStart;
+    double peak = peakMemoryMiB();
+
+    long long comparisons = 0;
+    auto counted = [&](const HeapKey &a, const HeapKey &b) { comparisons++; return higherKey(b, a); };
+    std::priority_queue<HeapKey, std::vector<HeapKey>, decltype(counted)> countedQueue(counted);
+    for (long i = 0; i < n; i++)
+        countedQueue.push({priorities[i], static_cast<JobId>(i)});
+    long long insertComparisons = comparisons;
+    comparisons = 0;
+    while (!countedQueue.empty())
+        countedQueue.pop();
+
+    std::cout << "std::priority_queue";
+    printSuiteOp("insert", n, insertTime, insertComparisons);
+    printSuiteOp("pop", n, popTime, comparisons);
+    std::cout << "\tpeak " << peak << " MiB\t(checksum " << checksum << ")" << std::endl;
+}
+
+
+
+// the whole suite: every size from 1000 up to 'maxSize' in steps of ten, with every priority distribution.
+// updates are capped at a million per run, so the largest sizes don't take all day
+void benchSuite(long maxSize) {
+    auto oldFlags = std::cout.flags();
+    auto oldPrecision = std::cout.precision();
+    std::cout << std::fixed << std::setprecision(1);
+
+    for (long size = std::min(1000L, maxSize); size <= maxSize; size *= 10) {
+        for (Spread spread : {Spread::Uniform, Spread::Skewed, Spread::Sorted, Spread::Duplicates}) {
+            std::mt19937 rng(12345);
+            std::vector<int> priorities(size);
+            for (long i = 0; i < size; i++)
+                priorities[i] = suitePriority(spread, i, rng);
+
+            std::vector<SuiteUpdate> updates(std::min(size, 1000000L));
+            for (auto &update : updates) {
+                update.job = static_cast<long>(rng() % size);
+                update.priority = suitePriority(spread, static_cast<long>(rng() % size), rng);
+            }
+
+            std::cout << "\n" << size << " jobs, " << spreadName(spread) << " priorities" << std::endl;
+            suiteQueue(priorities, updates, 1000);
+            suiteBaseline(priorities);
+        }
+    }
+
+    std::cout.flags(oldFlags);
+    std::cout.precision(oldPrecision);
+}
+
+
+
+int main(int argc, char **argv) {
+    // number of jobs can be given as the first argument, and the name of a single section to run as the second
+    long n = argc > 1 ? std::strtol(argv[1], nullptr, 10) : 1000000;
+    std::string section = argc > 2 ? argv[2] : "all";
+    auto runs = [&](const char *name) { return section == "all" || section == name; };
+
+    // the suite makes its own inputs for every size, up to n jobs
+    if (runs("suite")) {
+        std::cout << "operation suite, up to " << n << " jobs" << std::endl;
+        benchSuite(n);
+    }
+    if (section == "suite")
+        return 0;
+
+    // uniform random priorities with short names, so the names fit in the small string buffer
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<int> priorities(0, 1000000);
+    std::vector<PrintJob> input;
+    input.reserve(n);
+    for (long i = 0; i < n; i++)
+        input.emplace_back("job" + std::to_string(i), priorities(rng));
+
+    if (runs("arity")) {
+        std::cout << "d-ary heap of whole jobs, " << n << " jobs (sizeof(PrintJob) = " << sizeof(PrintJob) << ")" << std::endl;
+        benchArity<2>(input);
+        benchArity<4>(input);
+        benchArity<8>(input);
+        benchArity<16>(input);
+
+        // the same priorities as (priority, id) keys, the way PrintQueue stores them
+        std::vector<HeapKey> keys;
+        keys.reserve(n);
+        for (long i = 0; i < n; i++)
+            keys.push_back({input[i].priority, static_cast<JobId>(i)});
+
+        std::cout << "\nd-ary heap of keys, " << n << " jobs (sizeof(HeapKey) = " << sizeof(HeapKey) << ")" << std::endl;
+        benchArity<2>(keys);
+        benchArity<4>(keys);
+        benchArity<8>(keys);
+        benchArity<16>(keys);
+    }
+
+    if (runs("queue")) {
+        std::cout << "\nPrintQueue, arity " << HEAP_ARITY << ", " << n << " jobs" << std::endl;
+        benchQueue(input);
+        benchBulkLoad(input);
+        benchPopBatch(input, 1);
+        benchPopBatch(input, 1000);
+        benchPopBatch(input, static_cast<int>(n / 4));
+    }
+
+    if (runs("backend")) {
+        std::vector<TraceOp> inserts = insertHeavyTrace(input);
+        std::cout << "\ninsert-heavy trace, " << inserts.size() << " steps" << std::endl;
+        benchTrace<PrintQueue>("d-ary heap", input, inserts);
+        benchTrace<PairingQueue>("pairing heap", input, inserts);
+
+        std::vector<TraceOp> updates = updateHeavyTrace(input, rng, 1000, 0, 1000000);
+        std::cout << "\nupdate-heavy trace, " << updates.size() << " steps" << std::endl;
+        benchTrace<PrintQueue>("d-ary heap", input, updates);
+        benchTrace<PairingQueue>("pairing heap", input, updates);
+
+        // the same traces with priorities that all fit the bucket range
+        std::vector<PrintJob> bucketInput = input;
+        for (auto &job : bucketInput)
+            job.priority = BUCKET_MIN_PRIORITY + job.priority % BUCKET_LEVELS;
+
+        inserts = insertHeavyTrace(bucketInput);
+        std::cout << "\ninsert-heavy trace, priorities " << BUCKET_MIN_PRIORITY << "-" << BUCKET_MAX_PRIORITY << std::endl;
+        benchTrace<PrintQueue>("d-ary heap", bucketInput, inserts);
+        benchTrace<PairingQueue>("pairing heap", bucketInput, inserts);
+        benchTrace<BucketQueue>("bucket queue", bucketInput, inserts);
+
+        updates = updateHeavyTrace(bucketInput, rng, BUCKET_LEVELS / 16, BUCKET_MIN_PRIORITY, BUCKET_MAX_PRIORITY);
+        std::cout << "\nupdate-heavy trace, priorities " << BUCKET_MIN_PRIORITY << "-" << BUCKET_MAX_PRIORITY << std::endl;
+        benchTrace<PrintQueue>("d-ary heap", bucketInput, updates);
+        benchTrace<PairingQueue>("pairing heap", bucketInput, updates);
+        benchTrace<BucketQueue>("bucket queue", bucketInput, updates);
+
+        // and with most priorities outside of it, so the bucket queue mostly runs on its overflow heap
+        inserts = insertHeavyTrace(input);
+        std::cout << "\ninsert-heavy trace, priorities 0-1000000" << std::endl;
+        benchTrace<BucketQueue>("bucket queue", input, inserts);
+
+        // overload: the same inserts into a queue that only holds a tenth of them, and drops the lowest when full
+        std::cout << "\ninsert-heavy trace, at most " << n / 10 << " jobs queued" << std::endl;
+        benchTrace<BoundedQueue>("max-min heap", input, inserts, static_cast<int>(n / 10));
+    }
+
+    if (runs("aging")) {
+        std::cout << "\nsubmit one, print one, " << n / 10 << " jobs queued up front" << std::endl;
+        benchStarvation<PrintQueue>("no aging", input);
+        benchStarvation<AgingQueue>("aging", input);
+
+        // cost of a tick with millions of jobs queued: rewriting every key, against moving the epoch
+        PrintQueue plain;
+        insertBatch(plain, input);
+        AgingQueue aged;
+        for (const auto &job : input)
+            pushJob(aged, job.name, job.priority);
+
+        const int ticks = 100;
+        auto rewriteStart = BenchClock::now();
+        for (int tick = 0; tick < ticks; tick++) {
+            for (auto &key : plain.heap)
+                key.priority++;
+        }
+        auto rewriteTime = BenchClock::now() - rewriteStart;
+
+        auto epochStart = BenchClock::now();
+        for (int tick = 0; tick < ticks; tick++)
+            advanceEpoch(aged);
+        auto epochTime = BenchClock::now() - epochStart;
+
+        auto nanos = [](BenchClock::duration elapsed) { return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(); };
+        std::cout << "tick with " << n << " jobs queued\trewrite all keys " << nanos(rewriteTime) / ticks << " ns"
+                  << "\tmove epoch " << nanos(epochTime) / ticks << " ns"
+                  << "\t(" << plain.heap.front().priority << ", " << effectivePriority(aged, aged.heap.front().id) << ")" << std::endl;
+    }
+
+    if (runs("cancel")) {
+        std::cout << "\ncancel half of " << n << " queued jobs, then print the rest" << std::endl;
+        benchCancel(input, 0.5, 0.0);
+        benchCancel(input, 0.5, 0.25);
+        benchCancel(input, 0.5, 0.5);
+    }
+
+    if (runs("log")) {
+        std::string path = (std::filesystem::temp_directory_path() / "maxheap_bench.log").string();
+        std::cout << "\njob log, every insert committed before the next one" << std::endl;
+        for (int threads = 1; threads <= 8; threads *= 2)
+            benchLogCommit(path, threads, std::min(n, 2000L) / threads);
+        benchLogRecovery(path, input);
+    }
+
+    if (runs("snapshot")) {
+        std::string path = (std::filesystem::temp_directory_path() / "maxheap_bench.snapshot").string();
+        std::cout << "\nsnapshot of " << n << " queued jobs" << std::endl;
+        benchSnapshot(path, input);
+        benchSnapshotRecovery((std::filesystem::temp_directory_path() / "maxheap_bench.log").string(), input);
+    }
+
+    if (runs("mapped")) {
+        std::string path = (std::filesystem::temp_directory_path() / "maxheap_bench_mapped").string();
+        std::cout << "\nqueue in memory-mapped files, " << n << " jobs" << std::endl;
+        benchMapped(path, input);
+    }
+
+    if (runs("concurrent")) {
+        int maxThreads = static_cast<int>(std::thread::hardware_concurrency());
+        if (maxThreads < 4)
+            maxThreads = 4;
+
+        std::cout << "\nconcurrent submit + pop, " << n << " operations, " << n / 10 << " jobs queued up front" << std::endl;
+        for (int threads = 1; threads <= maxThreads; threads *= 2) {
+            benchThreads<GlobalLockQueue>("global lock", threads, n / 10, n);
+            benchThreads<ConcurrentPrintQueue>("sharded", threads, n / 10, n);
+            benchThreads<CombiningPrintQueue>("combining", threads, n / 10, n);
+            benchThreads<MultiQueue>("relaxed", threads, n / 10, n, threads, 2, true);
+        }
+    }
+
+    if (runs("ingest")) {
+        std::cout << "\nsubmit latency with one owner thread printing, " << n << " submissions" << std::endl;
+        for (int producers = 1; producers <= 4; producers *= 2) {
+            benchIngest(producers, n, false);
+            benchIngest(producers, n, true);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,304 @@
+#include "bounded_queue.h"
+
+#include <algorithm> // for std::min, std::max, std::push_heap, std::pop_heap
+#include <bit>       // for std::bit_width
+#include <utility>   // for std::swap
+
+
+
+// helper for telling if index i is on a max level. the root's level is a max level, and then they alternate
+static bool onMaxLevel(int i) {
+    return (std::bit_width(static_cast<unsigned>(i) + 1) - 1) % 2 == 0;
+}
+
+
+
+// the order for min levels, the opposite of higherKey
+static bool lowerKey(const HeapKey &a, const HeapKey &b) {
+    return a.priority < b.priority;
+}
+
+
+
+// helper for swapping two keys and recording their new indexes
+static void swapKeys(BoundedQueue &jobs, int i, int j) {
+    std::swap(jobs.heap[i], jobs.heap[j]);
+    jobs.positions[jobs.heap[i].id] = i;
+    jobs.positions[jobs.heap[j].id] = j;
+}
+
+
+
+// move the key at index i up along its own kind of level (every second level), as long as it belongs above the key there
+template<typename Before>
+static void bubbleUpLevels(BoundedQueue &jobs, int i, Before before) {
+    while (i >= 3) {
+        int grandparent = (i - 3) / 4;
+        if (!before(jobs.heap[i], jobs.heap[grandparent]))
+            break;
+        swapKeys(jobs, i, grandparent);
+        i = grandparent;
+    }
+}
+
+
+
+// restore the heap after the key at index i may have become too high or too low for its ancestors
+static void pushUp(BoundedQueue &jobs, int i) {
+    if (i == 0)
+        return;
+
+    // first see if the key belongs on the other kind of level, by checking it against its parent,
+    // then move it up along that kind of level
+    int parent = (i - 1) / 2;
+    if (onMaxLevel(i)) {
+        if (lowerKey(jobs.heap[i], jobs.heap[parent])) {
+            swapKeys(jobs, i, parent);
+            bubbleUpLevels(jobs, parent, lowerKey);
+        } else {
+            bubbleUpLevels(jobs, i, higherKey);
+        }
+    } else {
+        if (higherKey(jobs.heap[i], jobs.heap[parent])) {
+            swapKeys(jobs, i, parent);
+            bubbleUpLevels(jobs, parent, higherKey);
+        } else {
+            bubbleUpLevels(jobs, i, lowerKey);
+        }
+    }
+}
+
+
+
+// restore the heap below index i after the key there may have become too low (on a max level) or too high
+// (on a min level) for its subtree. the best key of the subtree is among the children and grandchildren
+static void pushDown(BoundedQueue &jobs, int i) {
+    auto before = onMaxLevel(i) ? higherKey : lowerKey;
+    int n = jobs.size();
+
+    while (true) {
+        int firstChild = 2 * i + 1;
+        if (firstChild >= n)
+            return;
+
+        int best = firstChild;
+        if (firstChild + 1 < n && before(jobs.heap[firstChild + 1], jobs.heap[best]))
+            best = firstChild + 1;
+        int firstGrandchild = 4 * i + 3;
+        int lastGrandchild = std::min(firstGrandchild + 4, n);
+        for (int g = firstGrandchild; g < lastGrandchild; g++) {
+            if (before(jobs.heap[g], jobs.heap[best]))
+                best = g;
+        }
+
+        if (!before(jobs.heap[best], jobs.heap[i]))
+            return;
+        swapKeys(jobs, i, best);
+
+        // a child is on the other kind of level and has no subtree of this kind below it, so that's the end
+        if (best < firstGrandchild)
+            return;
+
+        // the key moved down two levels. if it now belongs on the other kind of level than its new parent's,
+        // trade places with that parent, then keep going from the grandchild
+        int parent = (best - 1) / 2;
+        if (before(jobs.heap[parent], jobs.heap[best]))
+            swapKeys(jobs, best, parent);
+        i = best;
+    }
+}
+
+
+
+// index of the lowest key of a non-empty heap: the root if it is alone, otherwise the lower of its children
+static int lowestIndex(const BoundedQueue &jobs) {
+    int n = jobs.size();
+    if (n == 1)
+        return 0;
+    if (n == 2 || lowerKey(jobs.heap[1], jobs.heap[2]))
+        return 1;
+    return 2;
+}
+
+
+
+// take the key at index i out of the heap, hand its job to 'job', and free the job's id and name
+static void removeAt(BoundedQueue &jobs, int i, PrintJob &job) {
+    HeapKey key = jobs.heap[i];
+    HeapKey last = jobs.heap.back();
+    jobs.heap.pop_back();
+    if (i < jobs.size()) {
+        jobs.heap[i] = last;
+        jobs.positions[last.id] = i;
+        pushDown(jobs, i);
+        pushUp(jobs, jobs.positions[last.id]);
+    }
+
+    NameRef name = jobs.records[key.id].name;
+    job.name.assign(name.text);
+    job.priority = key.priority;
+
+    jobs.jobIds.erase(name.text);
+    jobs.names.release(name);
+    jobs.records[key.id].name = NameRef();
+    jobs.positions[key.id] = -1;
+    jobs.freeIds.push_back(key.id);
+}
+
+
+
+OfferResult offerJob(BoundedQueue &jobs, std::string_view name, int priority, PrintJob &evicted) {
+    if (jobs.jobIds.find(name) != NameIndex::NOT_FOUND)
+        return OfferResult::Duplicate;
+
+    OfferResult result = OfferResult::Added;
+    if (jobs.full()) {
+        int lowest = lowestIndex(jobs);
+        if (priority <= jobs.heap[lowest].priority)
+            return OfferResult::TooLow;
+        removeAt(jobs, lowest, evicted);
+        result = OfferResult::Evicted;
+    }
+
+    JobId id;
+    if (!jobs.freeIds.empty()) {
+        id = jobs.freeIds.back();
+        jobs.freeIds.pop_back();
+    } else {
+        id = static_cast<JobId>(jobs.records.size());
+        jobs.records.emplace_back();
+        jobs.positions.push_back(-1);
+    }
+    jobs.records[id].name = jobs.names.intern(name);
+    jobs.jobIds.insert(jobs.records[id].name.text, id);
+
+    jobs.heap.push_back({priority, id});
+    jobs.positions[id] = jobs.size() - 1;
+    pushUp(jobs, jobs.size() - 1);
+    return result;
+}
+
+
+
+bool pushJob(BoundedQueue &jobs, std::string_view name, int priority) {
+    PrintJob evicted;
+    OfferResult result = offerJob(jobs, name, priority, evicted);
+    return result == OfferResult::Added || result == OfferResult::Evicted;
+}
+
+
+
+bool popJob(BoundedQueue &jobs, PrintJob &job) {
+    if (jobs.empty())
+        return false;
+    removeAt(jobs, 0, job);
+    return true;
+}
+
+
+
+bool popLowestJob(BoundedQueue &jobs, PrintJob &job) {
+    if (jobs.empty())
+        return false;
+    removeAt(jobs, lowestIndex(jobs), job);
+    return true;
+}
+
+
+
+bool peekJob(const BoundedQueue &jobs, PrintJob &job) {
+    if (jobs.empty())
+        return false;
+
+    job.name.assign(jobName(jobs, jobs.heap[0]));
+    job.priority = jobs.heap[0].priority;
+    return true;
+}
+
+
+
+bool peekLowestJob(const BoundedQueue &jobs, PrintJob &job) {
+    if (jobs.empty())
+        return false;
+
+    const HeapKey &key = jobs.heap[lowestIndex(jobs)];
+    job.name.assign(jobName(jobs, key));
+    job.priority = key.priority;
+    return true;
+}
+
+
+
+bool changePriority(BoundedQueue &jobs, std::string_view name, int new_priority) {
+    JobId id = jobs.jobIds.find(name);
+    if (id == NameIndex::NOT_FOUND)
+        return false;
+
+    // the key may now be wrong for its subtree or for its ancestors, but not for both:
+    // once it has settled in its subtree, at most the way up is left
+    jobs.heap[jobs.positions[id]].priority = new_priority;
+    pushDown(jobs, jobs.positions[id]);
+    pushUp(jobs, jobs.positions[id]);
+    return true;
+}
+
+
+
+bool removeJob(BoundedQueue &jobs, std::string_view name) {
+    JobId id = jobs.jobIds.find(name);
+    if (id == NameIndex::NOT_FOUND)
+        return false;
+
+    PrintJob removed;
+    removeAt(jobs, jobs.positions[id], removed);
+    return true;
+}
+
+
+
+void reserveJobs(BoundedQueue &jobs, int n) {
+    n = std::min(n, jobs.capacity);
+    jobs.heap.reserve(n);
+    jobs.records.reserve(n);
+    jobs.positions.reserve(n);
+    jobs.jobIds.reserve(n);
+}
+
+
+
+std::vector<HeapKey> topK(const BoundedQueue &jobs, int k) {
+    std::vector<HeapKey> keys;
+    k = std::min(std::max(k, 0), jobs.size());
+    keys.reserve(k);
+    if (k == 0)
+        return keys;
+
+    // best-first walk over indexes. a node on a max level is above its whole subtree, so once it is taken
+    // its children and grandchildren are the only new candidates. a node on a min level isn't above its
+    // children, which is why they go into the frontier together with it
+    int n = jobs.size();
+    auto lower = [&](int a, int b) { return lowerKey(jobs.heap[a], jobs.heap[b]); };
+    std::vector<int> frontier{0};
+    auto add = [&](int i) {
+        if (i < n) {
+            frontier.push_back(i);
+            std::push_heap(frontier.begin(), frontier.end(), lower);
+        }
+    };
+
+    while (static_cast<int>(keys.size()) < k) {
+        std::pop_heap(frontier.begin(), frontier.end(), lower);
+        int best = frontier.back();
+        frontier.pop_back();
+        keys.push_back(jobs.heap[best]);
+
+        if (onMaxLevel(best)) {
+            for (int child = 2 * best + 1; child <= 2 * best + 2; child++) {
+                add(child);
+                add(2 * child + 1);
+                add(2 * child + 2);
+            }
+        }
+    }
+    return keys;
+}
@@ -0,0 +1,107 @@
+#ifndef MAXHEAP_BOUNDED_QUEUE_H
+#define MAXHEAP_BOUNDED_QUEUE_H
+
+#include <string_view>
+#include <vector>
+
+#include "print_queue.h"
+
+
+
+// default number of jobs a bounded queue holds. can be changed at compile time,
+// e.g. with -DMAXHEAP_CAPACITY=100000 (or the MAXHEAP_CAPACITY cmake cache variable)
+#ifndef MAXHEAP_CAPACITY
+#define MAXHEAP_CAPACITY 1024
+#endif
+
+constexpr int DEFAULT_CAPACITY = MAXHEAP_CAPACITY;
+
+static_assert(DEFAULT_CAPACITY > 0, "a bounded queue needs room for at least one job");
+
+
+
+// print queue that holds at most 'capacity' jobs, and sheds the least important job when it is full.
+// the keys are kept in a max-min heap: a binary heap whose levels alternate between max levels (the root's
+// level, and every second one below it) and min levels. a node on a max level belongs above everything in its
+// subtree, one on a min level below everything in its subtree. so the highest job is the root and the lowest
+// is one of the root's two children, both found in O(1), and either end is removed in O(log n).
+//
+// the jobs' names and ids are kept the same way as in PrintQueue
+struct BoundedQueue {
+    // (priority, id) keys in max-min heap order
+    std::vector<HeapKey> heap;
+
+    // job data and current heap index by id
+    std::vector<JobRecord> records;
+    std::vector<int> positions;
+    std::vector<JobId> freeIds;
+
+    NameArena names;
+    NameIndex jobIds;
+
+    int capacity;
+
+    explicit BoundedQueue(int capacity = DEFAULT_CAPACITY) : capacity(capacity) {}
+
+    bool empty() const { return heap.empty(); }
+    bool full() const { return size() >= capacity; }
+    int size() const { return static_cast<int>(heap.size()); }
+};
+
+
+
+// name of the job a key belongs to
+inline std::string_view jobName(const BoundedQueue &jobs, const HeapKey &key) {
+    return jobs.records[key.id].name.text;
+}
+
+
+
+// what happened to a job offered to a bounded queue
+enum class OfferResult {
+    // the job was added, and there was still room
+    Added,
+
+    // the job was added, and the job with the lowest priority was dropped to make room
+    Evicted,
+
+    // the queue is full and the job's priority isn't higher than the lowest one queued, so it was dropped
+    TooLow,
+
+    // a job with that name is already queued
+    Duplicate,
+};
+
+// add a job. if the queue is full, the job with the lowest priority is dropped into 'evicted' to make room,
+// unless the new job has no higher priority than that one, in which case the new job is dropped instead
+OfferResult offerJob(BoundedQueue &jobs, std::string_view name, int priority, PrintJob &evicted);
+
+// add a job, dropping the lowest one if the queue is full. returns false if the job wasn't added
+bool pushJob(BoundedQueue &jobs, std::string_view name, int priority);
+
+// remove the job with the highest priority into 'job'. returns false if the queue is empty
+bool popJob(BoundedQueue &jobs, PrintJob &job);
+
+// remove the job with the lowest priority into 'job'. returns false if the queue is empty
+bool popLowestJob(BoundedQueue &jobs, PrintJob &job);
+
+// copy the job with the highest priority into 'job', without removing it. returns false if the queue is empty
+bool peekJob(const BoundedQueue &jobs, PrintJob &job);
+
+// copy the job with the lowest priority into 'job', without removing it. returns false if the queue is empty
+bool peekLowestJob(const BoundedQueue &jobs, PrintJob &job);
+
+// change the priority of a queued job. returns false if no job with that name is queued
+bool changePriority(BoundedQueue &jobs, std::string_view name, int new_priority);
+
+// remove a queued job, wherever it is in the heap, in O(log n). returns false if no job with that name is queued
+bool removeJob(BoundedQueue &jobs, std::string_view name);
+
+// make room for 'n' queued jobs in total, so adding that many jobs doesn't reallocate
+void reserveJobs(BoundedQueue &jobs, int n);
+
+// keys of the k jobs with the highest priority (or of all jobs, if there are fewer), highest first.
+// the heap is not touched, and the cost is O(k log k)
+std::vector<HeapKey> topK(const BoundedQueue &jobs, int k);
+
+#endif // MAXHEAP_BOUNDED_QUEUE_H
@@ -0,0 +1,269 @@
+#include "bucket_queue.h"
+
+#include <algorithm> // for std::min, std::max, std::fill
+#include <bit>       // for std::countl_zero
+
+
+
+BucketQueue::BucketQueue() {
+    std::fill(std::begin(heads), std::end(heads), NONE);
+    std::fill(std::begin(tails), std::end(tails), NONE);
+}
+
+
+
+// helper for telling if a priority has a bucket
+static bool inBucketRange(int priority) {
+    return priority >= BUCKET_MIN_PRIORITY && priority <= BUCKET_MAX_PRIORITY;
+}
+
+
+
+// helper for finding the highest level that has jobs, or -1 if all buckets are empty
+static int highestLevel(const BucketQueue &jobs) {
+    for (int word = BUCKET_WORDS - 1; word >= 0; word--) {
+        if (jobs.levelBits[word] != 0)
+            return word * 64 + 63 - std::countl_zero(jobs.levelBits[word]);
+    }
+    return -1;
+}
+
+
+
+// helper for handing out an id for a new job, reusing the id of a finished job if there is one
+static JobId allocateId(BucketQueue &jobs) {
+    if (!jobs.freeIds.empty()) {
+        JobId id = jobs.freeIds.back();
+        jobs.freeIds.pop_back();
+        return id;
+    }
+    jobs.nodes.emplace_back();
+    return static_cast<JobId>(jobs.nodes.size() - 1);
+}
+
+
+
+// append a job at the back of the bucket for its priority
+static void linkJob(BucketQueue &jobs, JobId id) {
+    BucketNode &node = jobs.nodes[id];
+    int level = node.priority - BUCKET_MIN_PRIORITY;
+
+    node.position = -1;
+    node.next = BucketQueue::NONE;
+    node.prev = jobs.tails[level];
+    if (node.prev != BucketQueue::NONE)
+        jobs.nodes[node.prev].next = id;
+    else
+        jobs.heads[level] = id;
+    jobs.tails[level] = id;
+    jobs.levelBits[level / 64] |= std::uint64_t(1) << (level % 64);
+}
+
+
+
+// take a job out of the bucket for its priority
+static void unlinkJob(BucketQueue &jobs, JobId id) {
+    BucketNode &node = jobs.nodes[id];
+    int level = node.priority - BUCKET_MIN_PRIORITY;
+
+    if (node.prev != BucketQueue::NONE)
+        jobs.nodes[node.prev].next = node.next;
+    else
+        jobs.heads[level] = node.next;
+    if (node.next != BucketQueue::NONE)
+        jobs.nodes[node.next].prev = node.prev;
+    else
+        jobs.tails[level] = node.prev;
+
+    if (jobs.heads[level] == BucketQueue::NONE)
+        jobs.levelBits[level / 64] &= ~(std::uint64_t(1) << (level % 64));
+}
+
+
+
+// helper for recording the new index of a key that was moved inside the overflow heap
+static void overflowPlaced(BucketQueue &jobs, int i) {
+    jobs.nodes[jobs.overflow[i].id].position = i;
+}
+
+
+
+// put a job with a priority outside the bucket range into the overflow heap
+static void pushOverflow(BucketQueue &jobs, JobId id) {
+    jobs.overflow.push_back({jobs.nodes[id].priority, id});
+    siftUp(jobs.overflow, static_cast<int>(jobs.overflow.size() - 1), higherKey,
+           [&](int i) { overflowPlaced(jobs, i); });
+}
+
+
+
+// take the key at index i out of the overflow heap: the last key fills the gap and is sifted whichever way it has to go
+static void removeOverflow(BucketQueue &jobs, int i) {
+    HeapKey last = jobs.overflow.back();
+    jobs.overflow.pop_back();
+    int n = static_cast<int>(jobs.overflow.size());
+    if (i == n)
+        return;
+
+    jobs.overflow[i] = last;
+    auto placed = [&](int j) { overflowPlaced(jobs, j); };
+    siftUp(jobs.overflow, i, higherKey, placed);
+    siftDown(jobs.overflow, n, jobs.nodes[last.id].position, higherKey, placed);
+}
+
+
+
+// id of the job with the highest priority in a non-empty queue
+static JobId topId(const BucketQueue &jobs) {
+    int level = highestLevel(jobs);
+
+    // overflow jobs come first if they are above the range, or if there is nothing in the buckets
+    if (!jobs.overflow.empty() && (level < 0 || jobs.overflow.front().priority > BUCKET_MAX_PRIORITY))
+        return jobs.overflow.front().id;
+    return jobs.heads[level];
+}
+
+
+
+// take a queued job out of its bucket or the overflow heap, and free its name and id
+static void retireJob(BucketQueue &jobs, JobId id) {
+    BucketNode &node = jobs.nodes[id];
+    if (node.position >= 0)
+        removeOverflow(jobs, node.position);
+    else
+        unlinkJob(jobs, id);
+
+    jobs.jobIds.erase(node.name.text);
+    jobs.names.release(node.name);
+    node.name = NameRef();
+    jobs.freeIds.push_back(id);
+    jobs.count--;
+}
+
+
+
+bool pushJob(BucketQueue &jobs, std::string_view name, int priority) {
+    if (jobs.jobIds.find(name) != NameIndex::NOT_FOUND)
+        return false;
+
+    JobId id = allocateId(jobs);
+    jobs.nodes[id].priority = priority;
+    jobs.nodes[id].name = jobs.names.intern(name);
+    jobs.jobIds.insert(jobs.nodes[id].name.text, id);
+
+    if (inBucketRange(priority))
+        linkJob(jobs, id);
+    else
+        pushOverflow(jobs, id);
+    jobs.count++;
+    return true;
+}
+
+
+
+bool popJob(BucketQueue &jobs, PrintJob &job) {
+    if (jobs.empty())
+        return false;
+
+    JobId id = topId(jobs);
+    job.name.assign(jobs.nodes[id].name.text);
+    job.priority = jobs.nodes[id].priority;
+    retireJob(jobs, id);
+    return true;
+}
+
+
+
+bool peekJob(const BucketQueue &jobs, PrintJob &job) {
+    if (jobs.empty())
+        return false;
+
+    const BucketNode &node = jobs.nodes[topId(jobs)];
+    job.name.assign(node.name.text);
+    job.priority = node.priority;
+    return true;
+}
+
+
+
+bool changePriority(BucketQueue &jobs, std::string_view name, int new_priority) {
+    JobId id = jobs.jobIds.find(name);
+    if (id == NameIndex::NOT_FOUND)
+        return false;
+    BucketNode &node = jobs.nodes[id];
+
+    // within the overflow heap the key is just sifted, like in PrintQueue
+    if (node.position >= 0 && !inBucketRange(new_priority)) {
+        int old_priority = node.priority;
+        node.priority = new_priority;
+        jobs.overflow[node.position].priority = new_priority;
+        auto placed = [&](int i) { overflowPlaced(jobs, i); };
+        if (new_priority > old_priority)
+            siftUp(jobs.overflow, node.position, higherKey, placed);
+        else
+            siftDown(jobs.overflow, static_cast<int>(jobs.overflow.size()), node.position, higherKey, placed);
+        return true;
+    }
+
+    // otherwise the job leaves where it is and is put where its new priority belongs
+    if (node.position >= 0)
+        removeOverflow(jobs, node.position);
+    else
+        unlinkJob(jobs, id);
+
+    node.priority = new_priority;
+    if (inBucketRange(new_priority))
+        linkJob(jobs, id);
+    else
+        pushOverflow(jobs, id);
+    return true;
+}
+
+
+
+bool removeJob(BucketQueue &jobs, std::string_view name) {
+    JobId id = jobs.jobIds.find(name);
+    if (id == NameIndex::NOT_FOUND)
+        return false;
+
+    retireJob(jobs, id);
+    return true;
+}
+
+
+
+void reserveJobs(BucketQueue &jobs, int n) {
+    jobs.nodes.reserve(n);
+    jobs.jobIds.reserve(n);
+}
+
+
+
+std::vector<HeapKey> topK(const BucketQueue &jobs, int k) {
+    std::vector<HeapKey> keys;
+    k = std::min(std::max(k, 0), jobs.size());
+    keys.reserve(k);
+
+    // the best overflow keys in order. the ones above the range go before every bucket, the rest after them
+    std::vector<HeapKey> spill;
+    visitTopK(jobs.overflow, k, higherKey, [&](int i) { spill.push_back(jobs.overflow[i]); });
+    std::size_t nextSpill = 0;
+    while (nextSpill < spill.size() && spill[nextSpill].priority > BUCKET_MAX_PRIORITY)
+        keys.push_back(spill[nextSpill++]);
+
+    // the buckets from the highest level down, each in submission order
+    for (int word = BUCKET_WORDS - 1; word >= 0 && static_cast<int>(keys.size()) < k; word--) {
+        for (std::uint64_t bits = jobs.levelBits[word]; bits != 0 && static_cast<int>(keys.size()) < k;) {
+            int bit = 63 - std::countl_zero(bits);
+            bits &= ~(std::uint64_t(1) << bit);
+
+            int level = word * 64 + bit;
+            for (JobId id = jobs.heads[level]; id != BucketQueue::NONE && static_cast<int>(keys.size()) < k; id = jobs.nodes[id].next)
+                keys.push_back({jobs.nodes[id].priority, id});
+        }
+    }
+
+    while (nextSpill < spill.size() && static_cast<int>(keys.size()) < k)
+        keys.push_back(spill[nextSpill++]);
+    return keys;
+}
@@ -0,0 +1,121 @@
+#ifndef MAXHEAP_BUCKET_QUEUE_H
+#define MAXHEAP_BUCKET_QUEUE_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "print_queue.h"
+
+
+
+// range of priorities that get a bucket of their own. the defaults can be changed at compile time,
+// e.g. with -DMAXHEAP_BUCKET_MAX=1023 (or the cmake cache variables of the same names)
+#ifndef MAXHEAP_BUCKET_MIN
+#define MAXHEAP_BUCKET_MIN 0
+#endif
+#ifndef MAXHEAP_BUCKET_MAX
+#define MAXHEAP_BUCKET_MAX 255
+#endif
+
+constexpr int BUCKET_MIN_PRIORITY = MAXHEAP_BUCKET_MIN;
+constexpr int BUCKET_MAX_PRIORITY = MAXHEAP_BUCKET_MAX;
+constexpr int BUCKET_LEVELS = BUCKET_MAX_PRIORITY - BUCKET_MIN_PRIORITY + 1;
+
+static_assert(BUCKET_LEVELS > 0, "the bucket range needs at least one priority");
+
+// one bit per level in 64-bit words
+constexpr int BUCKET_WORDS = (BUCKET_LEVELS + 63) / 64;
+
+
+
+// one job in the bucket queue, indexed by job id
+struct BucketNode {
+    int priority = 0;
+
+    // neighbours in the job's bucket, oldest first. only used while the job is in a bucket
+    JobId prev = UINT32_MAX;
+    JobId next = UINT32_MAX;
+
+    // index in the overflow heap, or -1 while the job is in a bucket
+    int position = -1;
+
+    NameRef name;
+};
+
+
+
+// the print queue as a bucket queue: one FIFO list of jobs per priority level in the declared range, and a bitmap
+// of the levels that have jobs. the highest such level is found by counting leading zeros on a few words, so
+// insert, pop and changing a priority are all O(1), with no comparisons between jobs at all. jobs with the same
+// priority are printed in the order they were submitted.
+//
+// jobs with priorities outside the range go into a d-ary heap of keys instead, the same one PrintQueue uses.
+// above the range they are always printed before any bucket, below the range after all of them.
+// offers the same operations as PrintQueue, see job_queue.h for picking one of them at compile time
+struct BucketQueue {
+    // index used for "no job"
+    static constexpr JobId NONE = UINT32_MAX;
+
+    // job data by id
+    std::vector<BucketNode> nodes;
+
+    // ids of finished jobs that can be handed out again
+    std::vector<JobId> freeIds;
+
+    // oldest and newest job of every level, indexed by priority - BUCKET_MIN_PRIORITY
+    JobId heads[BUCKET_LEVELS];
+    JobId tails[BUCKET_LEVELS];
+
+    // bit 'level % 64' of word 'level / 64' is set while that level has jobs
+    std::uint64_t levelBits[BUCKET_WORDS] = {};
+
+    // jobs with priorities outside the bucket range
+    DaryHeap<HeapKey, HEAP_ARITY> overflow;
+
+    // storage for the names of all queued jobs, and the id of every queued job by name
+    NameArena names;
+    NameIndex jobIds;
+
+    int count = 0;
+
+    BucketQueue();
+
+    bool empty() const { return count == 0; }
+    int size() const { return count; }
+};
+
+
+
+// name of the job a key returned by topK belongs to
+inline std::string_view jobName(const BucketQueue &jobs, const HeapKey &key) {
+    return jobs.nodes[key.id].name.text;
+}
+
+
+
+// add a job. returns false (and changes nothing) if a job with that name is already queued
+bool pushJob(BucketQueue &jobs, std::string_view name, int priority);
+
+// remove the job with the highest priority into 'job'. returns false if the queue is empty
+bool popJob(BucketQueue &jobs, PrintJob &job);
+
+// copy the job with the highest priority into 'job', without removing it. returns false if the queue is empty
+bool peekJob(const BucketQueue &jobs, PrintJob &job);
+
+// change the priority of a queued job. returns false if no job with that name is queued.
+// the job goes to the back of its new level, as if it was submitted with that priority just now
+bool changePriority(BucketQueue &jobs, std::string_view name, int new_priority);
+
+// remove a queued job, wherever it is in the queue. O(1) for a job in a bucket,
+// O(log n) for one in the overflow heap. returns false if no job with that name is queued
+bool removeJob(BucketQueue &jobs, std::string_view name);
+
+// make room for 'n' queued jobs in total, so adding that many jobs doesn't reallocate
+void reserveJobs(BucketQueue &jobs, int n);
+
+// keys of the k jobs with the highest priority (or of all jobs, if there are fewer), highest first.
+// the queue is not touched
+std::vector<HeapKey> topK(const BucketQueue &jobs, int k);
+
+#endif // MAXHEAP_BUCKET_QUEUE_H
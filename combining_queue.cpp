@@ -0,0 +1,145 @@
+#include "combining_queue.h"
+
+#include <algorithm>  // for std::stable_sort
+#include <functional> // for std::hash
+#include <thread>
+
+
+
+bool CombiningPrintQueue::execute(Op op, std::string_view name, int priority, PrintJob *job) {
+    // claim a free slot, starting at one that depends on the thread so threads don't all race for slot 0
+    std::size_t start = std::hash<std::thread::id>{}(std::this_thread::get_id());
+    Slot *slot = nullptr;
+    for (std::size_t i = 0; slot == nullptr; i++) {
+        Slot &candidate = slots[(start + i) % SLOT_COUNT];
+        int expected = Free;
+        if (candidate.state.load(std::memory_order_relaxed) == Free &&
+            candidate.state.compare_exchange_strong(expected, Claimed, std::memory_order_acquire))
+            slot = &candidate;
+        else if (i % SLOT_COUNT == SLOT_COUNT - 1)
+            std::this_thread::yield();
+    }
+
+    slot->op = op;
+    slot->name = name;
+    slot->priority = priority;
+    slot->job = job;
+    slot->state.store(Pending, std::memory_order_release);
+
+    // wait for the result, becoming the combiner whenever nobody else is
+    for (int spins = 0; slot->state.load(std::memory_order_acquire) != Done; spins++) {
+        if (!combining.load(std::memory_order_relaxed) && !combining.exchange(true, std::memory_order_acquire)) {
+            combine();
+            combining.store(false, std::memory_order_release);
+        } else if (spins % 64 == 63) {
+            std::this_thread::yield();
+        }
+    }
+
+    bool result = slot->result;
+    slot->state.store(Free, std::memory_order_release);
+    return result;
+}
+
+
+
+void CombiningPrintQueue::combine() {
+    inserts.clear();
+    pops.clear();
+    peeks.clear();
+    leftover.clear();
+
+    // collect every pending request. updates are run right away, the rest is sorted by kind
+    for (auto &slot : slots) {
+        if (slot.state.load(std::memory_order_acquire) != Pending)
+            continue;
+
+        switch (slot.op) {
+            case Op::Insert: {
+                // reject names that are queued, or that an earlier insert in this batch already claimed
+                bool duplicate = queue.jobIds.find(slot.name) != NameIndex::NOT_FOUND;
+                for (std::size_t i = 0; i < inserts.size() && !duplicate; i++)
+                    duplicate = inserts[i]->name == slot.name;
+
+                if (duplicate) {
+                    slot.result = false;
+                    slot.state.store(Done, std::memory_order_release);
+                } else {
+                    inserts.push_back(&slot);
+                }
+                break;
+            }
+            case Op::Pop:
+                pops.push_back(&slot);
+                break;
+            case Op::Update:
+                slot.result = changePriority(queue, slot.name, slot.priority);
+                slot.state.store(Done, std::memory_order_release);
+                break;
+            case Op::Peek:
+                peeks.push_back(&slot);
+                break;
+        }
+    }
+    if (inserts.empty() && pops.empty() && peeks.empty())
+        return;
+    batches.fetch_add(1, std::memory_order_relaxed);
+
+    // the batch runs as if all inserts happened before all pops. then a pop takes the best of the heap top
+    // and the best insert, and whenever that is an insert, the pair cancels out without touching the heap
+    std::stable_sort(inserts.begin(), inserts.end(), [](const Slot *a, const Slot *b) { return a->priority > b->priority; });
+
+    std::size_t nextInsert = 0;
+    for (Slot *pop : pops) {
+        if (nextInsert < inserts.size() && (queue.empty() || inserts[nextInsert]->priority >= queue.heap.front().priority)) {
+            Slot *insert = inserts[nextInsert++];
+            pop->job->name.assign(insert->name);
+            pop->job->priority = insert->priority;
+            pop->result = true;
+            insert->result = true;
+            insert->state.store(Done, std::memory_order_release);
+            eliminated.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            pop->result = popJob(queue, *pop->job);
+        }
+        pop->state.store(Done, std::memory_order_release);
+    }
+
+    // whatever inserts are left go into the heap together
+    for (std::size_t i = nextInsert; i < inserts.size(); i++)
+        leftover.push_back({inserts[i]->name, inserts[i]->priority});
+    insertBatch(queue, leftover);
+    for (std::size_t i = nextInsert; i < inserts.size(); i++) {
+        inserts[i]->result = true;
+        inserts[i]->state.store(Done, std::memory_order_release);
+    }
+
+    for (Slot *peek : peeks) {
+        peek->result = peekJob(queue, *peek->job);
+        peek->state.store(Done, std::memory_order_release);
+    }
+}
+
+
+
+bool CombiningPrintQueue::insert(std::string_view name, int priority) {
+    return execute(Op::Insert, name, priority, nullptr);
+}
+
+
+
+bool CombiningPrintQueue::tryPop(PrintJob &job) {
+    return execute(Op::Pop, {}, 0, &job);
+}
+
+
+
+bool CombiningPrintQueue::update(std::string_view name, int new_priority) {
+    return execute(Op::Update, name, new_priority, nullptr);
+}
+
+
+
+bool CombiningPrintQueue::peek(PrintJob &job) {
+    return execute(Op::Peek, {}, 0, &job);
+}
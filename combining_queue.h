@@ -0,0 +1,83 @@
+#ifndef MAXHEAP_COMBINING_QUEUE_H
+#define MAXHEAP_COMBINING_QUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "print_queue.h"
+
+
+
+// thread-safe print queue using flat combining.
+// a thread doesn't lock the heap for its own operation. it writes the request into a slot and waits.
+// whichever waiting thread gets the combiner flag first runs every pending request on the heap in one go,
+// while the others just watch their own slot. so the heap and its cache lines stay with one thread at a time,
+// and the lock changes hands once per batch instead of once per operation.
+//
+// within a batch, the combiner also pairs inserts with pops: a pop that would take a job inserted in the
+// same batch gets it directly, and that job never touches the heap. the remaining inserts go in with one insertBatch
+class CombiningPrintQueue {
+public:
+    // number of request slots, which is the most threads that can have a request waiting at the same time
+    static constexpr int SLOT_COUNT = 64;
+
+    // add a job. returns false if a job with that name is already queued
+    bool insert(std::string_view name, int priority);
+
+    // remove the job with the highest priority into 'job'. returns false if the queue is empty
+    bool tryPop(PrintJob &job);
+
+    // change the priority of a queued job. returns false if no job with that name is queued
+    bool update(std::string_view name, int new_priority);
+
+    // copy the job with the highest priority into 'job' without removing it. returns false if the queue is empty
+    bool peek(PrintJob &job);
+
+    // number of batches run, and number of insert/pop pairs that were handed over without touching the heap
+    std::uint64_t batchCount() const { return batches.load(std::memory_order_relaxed); }
+    std::uint64_t eliminatedCount() const { return eliminated.load(std::memory_order_relaxed); }
+
+private:
+    enum class Op { Insert, Pop, Update, Peek };
+
+    // life of a slot: Free -> Claimed (owner fills it in) -> Pending (waiting for a combiner) -> Done -> Free
+    enum State : int { Free, Claimed, Pending, Done };
+
+    struct alignas(CACHE_LINE_SIZE) Slot {
+        std::atomic<int> state{Free};
+        Op op = Op::Insert;
+        std::string_view name;
+        int priority = 0;
+        PrintJob *job = nullptr;
+        bool result = false;
+    };
+
+    // publish a request, and wait until some combiner (maybe this thread) has run it
+    bool execute(Op op, std::string_view name, int priority, PrintJob *job);
+
+    // run every pending request. only called with the combiner flag held
+    void combine();
+
+    Slot slots[SLOT_COUNT];
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> combining{false};
+
+    // an insert that is left over after pairing, in the shape insertBatch takes
+    struct PendingJob {
+        std::string_view name;
+        int priority;
+    };
+
+    // everything below is only touched by the combiner
+    alignas(CACHE_LINE_SIZE) PrintQueue queue;
+    std::vector<Slot *> inserts;
+    std::vector<Slot *> pops;
+    std::vector<Slot *> peeks;
+    std::vector<PendingJob> leftover;
+
+    std::atomic<std::uint64_t> batches{0};
+    std::atomic<std::uint64_t> eliminated{0};
+};
+
+#endif // MAXHEAP_COMBINING_QUEUE_H
@@ -0,0 +1,181 @@
+#include "concurrent_queue.h"
+
+#include <functional> // for std::hash
+
+
+
+ConcurrentPrintQueue::Shard &ConcurrentPrintQueue::shardFor(std::string_view name) {
+    // use the top bits of a multiplicative mix, the name index inside the shard uses the low bits
+    std::uint64_t hash = std::hash<std::string_view>{}(name);
+    return shards[(hash * 0x9E3779B97F4A7C15ull) >> (64 - SHARD_BITS)];
+}
+
+
+
+bool ConcurrentPrintQueue::insert(std::string_view name, int priority) {
+    Shard &shard = shardFor(name);
+    std::lock_guard<std::mutex> shardGuard(shard.lock);
+
+    if (shard.ids.find(name) != NameIndex::NOT_FOUND)
+        return false;
+
+    // register the name in its shard, outside of the heap lock
+    JobId local;
+    if (!shard.freeLocalIds.empty()) {
+        local = shard.freeLocalIds.back();
+        shard.freeLocalIds.pop_back();
+    } else {
+        shard.namesByLocalId.emplace_back();
+        local = static_cast<JobId>(shard.namesByLocalId.size() - 1);
+    }
+    NameRef ref = shard.names.intern(name);
+    shard.namesByLocalId[local] = ref;
+
+    JobId id = (local << SHARD_BITS) | static_cast<JobId>(&shard - shards);
+    shard.ids.insert(ref.text, id);
+
+    // the heap lock only covers the sift. holding the shard lock as well keeps the
+    // insert atomic for anyone looking the name up
+    std::lock_guard<std::mutex> heapGuard(heapLock);
+    if (positions.size() <= id)
+        positions.resize(id + 1, -1);
+
+    heap.push_back({priority, id});
+    siftUp(heap, static_cast<int>(heap.size() - 1), higherKey, [&](int i) { positions[heap[i].id] = i; });
+
+    if (waiting > 0)
+        nonEmpty.notify_one();
+    return true;
+}
+
+
+
+HeapKey ConcurrentPrintQueue::popKeyLocked() {
+    HeapKey top = popTop(heap, higherKey, [&](int i) { positions[heap[i].id] = i; });
+    positions[top.id] = -1;
+    return top;
+}
+
+
+
+void ConcurrentPrintQueue::finishPop(const HeapKey &key, PrintJob &job) {
+    Shard &shard = shards[key.id & (SHARD_COUNT - 1)];
+    JobId local = key.id >> SHARD_BITS;
+
+    std::lock_guard<std::mutex> shardGuard(shard.lock);
+    NameRef ref = shard.namesByLocalId[local];
+    job.name.assign(ref.text);
+    job.priority = key.priority;
+
+    // until here the name was still registered, so an insert of the same name was rejected as a duplicate,
+    // and an update found the key already gone from the heap
+    shard.ids.erase(ref.text);
+    shard.names.release(ref);
+    shard.namesByLocalId[local] = NameRef();
+    shard.freeLocalIds.push_back(local);
+}
+
+
+
+bool ConcurrentPrintQueue::tryPop(PrintJob &job) {
+    HeapKey key;
+    {
+        std::lock_guard<std::mutex> heapGuard(heapLock);
+        if (heap.empty())
+            return false;
+        key = popKeyLocked();
+    }
+    finishPop(key, job);
+    return true;
+}
+
+
+
+bool ConcurrentPrintQueue::waitPop(PrintJob &job) {
+    HeapKey key;
+    {
+        std::unique_lock<std::mutex> heapGuard(heapLock);
+        waiting++;
+        nonEmpty.wait(heapGuard, [&] { return !heap.empty() || closed; });
+        waiting--;
+
+        if (heap.empty())
+            return false;
+        key = popKeyLocked();
+    }
+    finishPop(key, job);
+    return true;
+}
+
+
+
+bool ConcurrentPrintQueue::update(std::string_view name, int new_priority) {
+    // holding the shard lock pins the id to this name: it can't be released and handed to another job meanwhile
+    Shard &shard = shardFor(name);
+    std::lock_guard<std::mutex> shardGuard(shard.lock);
+
+    JobId id = shard.ids.find(name);
+    if (id == NameIndex::NOT_FOUND)
+        return false;
+
+    std::lock_guard<std::mutex> heapGuard(heapLock);
+    int index = positions[id];
+
+    // the job was just popped, and only its name is still waiting to be released
+    if (index < 0)
+        return false;
+
+    int old_priority = heap[index].priority;
+    heap[index].priority = new_priority;
+
+    auto placed = [&](int i) { positions[heap[i].id] = i; };
+    if (new_priority > old_priority) {
+        siftUp(heap, index, higherKey, placed);
+    } else {
+        siftDown(heap, static_cast<int>(heap.size()), index, higherKey, placed);
+    }
+    return true;
+}
+
+
+
+bool ConcurrentPrintQueue::peek(PrintJob &job) const {
+    while (true) {
+        // find out which shard holds the top job's name
+        HeapKey top;
+        {
+            std::lock_guard<std::mutex> heapGuard(heapLock);
+            if (heap.empty())
+                return false;
+            top = heap.front();
+        }
+
+        // then take the locks in the usual order, and check the top didn't change in between
+        const Shard &shard = shards[top.id & (SHARD_COUNT - 1)];
+        std::lock_guard<std::mutex> shardGuard(shard.lock);
+        std::lock_guard<std::mutex> heapGuard(heapLock);
+        if (heap.empty())
+            return false;
+        if (heap.front().id != top.id)
+            continue;
+
+        job.name.assign(shard.namesByLocalId[top.id >> SHARD_BITS].text);
+        job.priority = heap.front().priority;
+        return true;
+    }
+}
+
+
+
+int ConcurrentPrintQueue::size() const {
+    std::lock_guard<std::mutex> heapGuard(heapLock);
+    return static_cast<int>(heap.size());
+}
+
+
+
+void ConcurrentPrintQueue::close() {
+    std::lock_guard<std::mutex> heapGuard(heapLock);
+    closed = true;
+    nonEmpty.notify_all();
+}
@@ -0,0 +1,83 @@
+#ifndef MAXHEAP_CONCURRENT_QUEUE_H
+#define MAXHEAP_CONCURRENT_QUEUE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "print_queue.h"
+
+
+
+// print queue that many submitter and printer threads can use at the same time.
+//
+// the work of an operation is split between two kinds of locks, so a single global lock doesn't
+// serialize everything:
+//  - the names live in SHARD_COUNT shards, picked by the hash of the name. each shard has its own lock,
+//    arena, name index and id table, so the duplicate check, hashing and copying of names run in
+//    parallel for names in different shards
+//  - the heap of 8-byte (priority, id) keys has one lock, but it is only held for the sift itself
+//
+// locks are always taken shard first, then heap, never the other way round.
+// a job id carries the index of its shard in the low bits, so the shard of a popped key is known without its name
+class ConcurrentPrintQueue {
+public:
+    static constexpr int SHARD_BITS = 4;
+    static constexpr int SHARD_COUNT = 1 << SHARD_BITS;
+
+    // add a job. returns false if a job with that name is queued (or still being popped)
+    bool insert(std::string_view name, int priority);
+
+    // remove the job with the highest priority into 'job'. returns false right away if the queue is empty
+    bool tryPop(PrintJob &job);
+
+    // remove the job with the highest priority into 'job', waiting for one if the queue is empty.
+    // returns false only once the queue is closed and empty
+    bool waitPop(PrintJob &job);
+
+    // change the priority of a queued job. returns false if no job with that name is queued
+    bool update(std::string_view name, int new_priority);
+
+    // copy the job with the highest priority into 'job' without removing it. returns false if the queue is empty
+    bool peek(PrintJob &job) const;
+
+    // number of queued jobs
+    int size() const;
+
+    // wake every thread blocked in waitPop. they drain what is left, then waitPop returns false
+    void close();
+
+private:
+    // one shard of the name registry, on its own cache lines so shards don't falsely share them
+    struct alignas(CACHE_LINE_SIZE) Shard {
+        mutable std::mutex lock;
+        NameArena names;
+        NameIndex ids;
+
+        // name by the part of the job id above the shard bits
+        std::vector<NameRef> namesByLocalId;
+        std::vector<JobId> freeLocalIds;
+    };
+
+    Shard &shardFor(std::string_view name);
+
+    // second half of every pop: hand the job's name to 'job' and release it from its shard
+    void finishPop(const HeapKey &key, PrintJob &job);
+
+    // pop the top key and mark it as gone. the heap lock must be held, and the heap must not be empty
+    HeapKey popKeyLocked();
+
+    Shard shards[SHARD_COUNT];
+
+    // everything below is guarded by heapLock
+    mutable std::mutex heapLock;
+    std::condition_variable nonEmpty;
+    DaryHeap<HeapKey, HEAP_ARITY> heap;
+    std::vector<int> positions;
+    int waiting = 0;
+    bool closed = false;
+};
+
+#endif // MAXHEAP_CONCURRENT_QUEUE_H
@@ -0,0 +1,260 @@
+#ifndef MAXHEAP_DARY_HEAP_H
+#define MAXHEAP_DARY_HEAP_H
+
+#include <algorithm> // for std::min, std::push_heap, std::pop_heap
+#include <cstddef>
+#include <new>       // for std::align_val_t
+#include <type_traits>
+#include <utility>   // for std::move
+#include <vector>
+
+
+
+// number of children per heap node. the default can be changed at compile time,
+// e.g. with -DMAXHEAP_ARITY=8 (or the MAXHEAP_ARITY cmake cache variable)
+#ifndef MAXHEAP_ARITY
+#define MAXHEAP_ARITY 4
+#endif
+
+constexpr int HEAP_ARITY = MAXHEAP_ARITY;
+
+static_assert(HEAP_ARITY >= 2, "a heap needs at least two children per node");
+
+// size of one cache line on the machines we run on
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+
+
+// index arithmetic for a d-ary heap stored in an array with the root at index 0.
+// the children of node i are at Arity * i + 1 ... Arity * i + Arity
+template<int Arity>
+struct DaryLayout {
+    static int parent(int i) { return (i - 1) / Arity; }
+    static int firstChild(int i) { return Arity * i + 1; }
+};
+
+
+
+// allocator that lines the children of every heap node up with a cache line.
+// the first child of node i is at Arity * i + 1, so if element 0 is placed Arity - 1 slots
+// after a cache line boundary, the child group of node i starts Arity * (i + 1) slots after it.
+// whenever Arity * sizeof(T) is a multiple of the line size, every child group then sits
+// in its own line(s), and picking the largest child never touches a line shared with another group
+template<typename T, int Arity>
+struct ChildGroupAllocator {
+    using value_type = T;
+
+    // number of unused slots in front of the root
+    static constexpr std::size_t SKEW = Arity - 1;
+
+    // rebind has to be spelled out, since allocator_traits can't rebind the non-type parameter
+    template<typename U>
+    struct rebind { using other = ChildGroupAllocator<U, Arity>; };
+
+    ChildGroupAllocator() = default;
+
+    template<typename U>
+    ChildGroupAllocator(const ChildGroupAllocator<U, Arity> &) {}
+
+    T *allocate(std::size_t n) {
+        void *block = ::operator new((n + SKEW) * sizeof(T), std::align_val_t(CACHE_LINE_SIZE));
+        return static_cast<T *>(block) + SKEW;
+    }
+
+    void deallocate(T *p, std::size_t) {
+        ::operator delete(p - SKEW, std::align_val_t(CACHE_LINE_SIZE));
+    }
+
+    friend bool operator==(const ChildGroupAllocator &, const ChildGroupAllocator &) { return true; }
+};
+
+
+
+// heap storage. it behaves like a plain std::vector, only the allocation is aligned for the arity,
+// so code written against the vector interface keeps working when the arity changes
+template<typename T, int Arity = HEAP_ARITY>
+using DaryHeap = std::vector<T, ChildGroupAllocator<T, Arity>>;
+
+
+
+// the routines below work on any heap storage with the vector interface they use (operator[], size, front,
+// back, pop_back). DaryHeap carries its arity in the allocator, other storage (see mapped_storage.h)
+// declares it as a static member 'arity'
+template<typename Heap>
+constexpr int heapArity = Heap::arity;
+
+template<typename T, int Arity>
+constexpr int heapArity<std::vector<T, ChildGroupAllocator<T, Arity>>> = Arity;
+
+
+
+// the sift routines below work with a "hole" instead of swaps: the element being sifted is lifted
+// out once, every element it passes is moved exactly once into the hole, and the element is written
+// back a single time at its final index. a swap would cost three moves per level instead of one.
+
+
+
+// move 'value' up from the hole at index i until its parent belongs above it, then store it there
+template<typename Heap, typename Higher, typename Placed>
+int fillHoleUpwards(Heap &heap, int i, typename Heap::value_type value, Higher higher, Placed placed) {
+    constexpr int Arity = heapArity<Heap>;
+    while (i > 0) {
+        int parent = DaryLayout<Arity>::parent(i);
+        if (!higher(value, heap[parent]))
+            break;
+
+        // the parent drops into the hole, and the hole moves up
+        heap[i] = std::move(heap[parent]);
+        placed(i);
+        i = parent;
+    }
+    heap[i] = std::move(value);
+    placed(i);
+    return i;
+}
+
+
+
+// index of the best child of 'parent' among the first n elements, or -1 if parent is a leaf.
+// all children of a node are next to each other, so this is a single scan over one child group
+template<typename Heap, typename Higher>
+int bestChild(Heap &heap, int n, int parent, Higher higher) {
+    constexpr int Arity = heapArity<Heap>;
+    int first = DaryLayout<Arity>::firstChild(parent);
+    if (first >= n)
+        return -1;
+
+    int best = first;
+    int last = std::min(first + Arity, n);
+    for (int child = first + 1; child < last; child++) {
+        if (higher(heap[child], heap[best]))
+            best = child;
+    }
+    return best;
+}
+
+
+
+// restore the heap property on the subtree rooted at parent, considering only the first n elements.
+// 'higher(a, b)' tells if a belongs above b, and 'placed(i)' is called whenever an element lands on index i,
+// so callers can keep an index of positions up to date
+template<typename Heap, typename Higher, typename Placed>
+void siftDown(Heap &heap, int n, int parent, Higher higher, Placed placed) {
+    typename Heap::value_type value = std::move(heap[parent]);
+    int hole = parent;
+
+    while (true) {
+        int child = bestChild(heap, n, hole, higher);
+
+        // stop once no child belongs above the lifted element
+        if (child < 0 || !higher(heap[child], value))
+            break;
+
+        heap[hole] = std::move(heap[child]);
+        placed(hole);
+        hole = child;
+    }
+    heap[hole] = std::move(value);
+    placed(hole);
+}
+
+
+
+// move the element at index i up until its parent belongs above it
+template<typename Heap, typename Higher, typename Placed>
+void siftUp(Heap &heap, int i, Higher higher, Placed placed) {
+    typename Heap::value_type value = std::move(heap[i]);
+    fillHoleUpwards(heap, i, std::move(value), higher, placed);
+}
+
+
+
+// remove and return the root of a non-empty heap using Floyd's bottom-up deletion.
+// the hole left by the root is walked all the way down to a leaf, always following the best child,
+// which only costs the comparisons between siblings. the last element is then dropped into that leaf
+// and sifted up, which is usually zero or one level since it came from the bottom of the heap anyway.
+// compared to sifting the last element down from the root, this skips the comparison against
+// the sifted element on every level
+template<typename Heap, typename Higher, typename Placed>
+typename Heap::value_type popTop(Heap &heap, Higher higher, Placed placed) {
+    typename Heap::value_type top = std::move(heap.front());
+    typename Heap::value_type last = std::move(heap.back());
+    heap.pop_back();
+
+    int n = static_cast<int>(heap.size());
+    if (n == 0)
+        return top;
+
+    // walk the hole down to a leaf
+    int hole = 0;
+    int child;
+    while ((child = bestChild(heap, n, hole, higher)) >= 0) {
+        heap[hole] = std::move(heap[child]);
+        placed(hole);
+        hole = child;
+    }
+
+    // put the old last element in the leaf and let it float up to where it belongs
+    fillHoleUpwards(heap, hole, std::move(last), higher, placed);
+    return top;
+}
+
+
+
+// turn the first n elements into a heap with Floyd's bottom-up construction: every internal node is
+// sifted down, starting from the last one. that is O(n) in total instead of the O(n log n) of n
+// single inserts, since most nodes sit near the bottom and can only sift down a level or two
+template<typename Heap, typename Higher, typename Placed>
+void buildHeap(Heap &heap, int n, Higher higher, Placed placed) {
+    if (n < 2)
+        return;
+
+    for (int i = DaryLayout<heapArity<Heap>>::parent(n - 1); i >= 0; i--)
+        siftDown(heap, n, i, higher, placed);
+}
+
+
+
+// visit the indexes of the k best elements in order, best first, without modifying the heap.
+// only the root can be the best element, and after that the next best is always a child of one
+// that was already visited. so a small frontier heap of candidate indexes is enough: take the
+// best candidate, then add its children. that costs O(k log k) instead of sorting all n elements.
+// if 'visit' returns a bool, only the elements it returns true for count towards k, so callers can skip entries
+template<typename Heap, typename Higher, typename Visit>
+void visitTopK(const Heap &heap, int k, Higher higher, Visit visit) {
+    constexpr int Arity = heapArity<Heap>;
+    int n = static_cast<int>(heap.size());
+    if (k > n)
+        k = n;
+    if (k <= 0)
+        return;
+
+    // the std heap algorithms keep the "largest" element at the front, so order indexes by reversed 'higher'
+    auto lower = [&](int a, int b) { return higher(heap[b], heap[a]); };
+
+    std::vector<int> frontier;
+    frontier.reserve(static_cast<std::size_t>(k) * (Arity - 1) + 1);
+    frontier.push_back(0);
+
+    for (int visited = 0; visited < k && !frontier.empty();) {
+        std::pop_heap(frontier.begin(), frontier.end(), lower);
+        int best = frontier.back();
+        frontier.pop_back();
+        if constexpr (std::is_same_v<decltype(visit(best)), bool>) {
+            if (visit(best))
+                visited++;
+        } else {
+            visit(best);
+            visited++;
+        }
+
+        int first = DaryLayout<Arity>::firstChild(best);
+        int last = std::min(first + Arity, n);
+        for (int child = first; child < last; child++) {
+            frontier.push_back(child);
+            std::push_heap(frontier.begin(), frontier.end(), lower);
+        }
+    }
+}
+
+#endif // MAXHEAP_DARY_HEAP_H
@@ -0,0 +1,436 @@
+#include "job_log.h"
+
+#include <cerrno>
+#include <cstring>       // for std::memcpy, std::memcmp
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "name_index.h"
+
+
+
+// first bytes of every job log file
+static constexpr char LOG_MAGIC[8] = {'M', 'H', 'J', 'O', 'B', 'L', 'O', 'G'};
+
+// bytes of a record before the name: checksum, op, priority, name length
+static constexpr std::size_t RECORD_HEADER = 4 + 1 + 4 + 4;
+
+
+
+// 32-bit FNV-1a over a range of bytes, continuing from 'hash'. not cryptographic, just enough to notice a torn write
+static std::uint32_t checksum(const char *data, std::size_t size, std::uint32_t hash = 2166136261u) {
+    for (std::size_t i = 0; i < size; i++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+
+
+// helper for writing a whole buffer, however many write calls that takes
+static bool writeAll(int fd, const char *data, std::size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+
+
+// helper for filling in the header of a record, checksum included
+static void encodeHeader(char *header, LogOp op, std::string_view name, int priority) {
+    auto length = static_cast<std::uint32_t>(name.size());
+    header[4] = static_cast<char>(op);
+    std::memcpy(header + 5, &priority, 4);
+    std::memcpy(header + 9, &length, 4);
+
+    // the checksum covers the rest of the header and the name
+    std::uint32_t sum = checksum(name.data(), name.size(), checksum(header + 4, RECORD_HEADER - 4));
+    std::memcpy(header, &sum, 4);
+}
+
+
+
+JobLog::~JobLog() {
+    close();
+}
+
+
+
+bool JobLog::open(const std::string &path, std::uint32_t generation) {
+    close();
+
+    int file = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (file < 0)
+        return false;
+
+    struct stat info {};
+    if (::fstat(file, &info) != 0) {
+        ::close(file);
+        return false;
+    }
+
+    if (info.st_size == 0) {
+        // a new log: the header has to be on disk before any record is
+        if (!writeAll(file, LOG_MAGIC, sizeof(LOG_MAGIC)) || ::fsync(file) != 0) {
+            ::close(file);
+            return false;
+        }
+    } else {
+        char magic[sizeof(LOG_MAGIC)];
+        if (::pread(file, magic, sizeof(magic), 0) != static_cast<ssize_t>(sizeof(magic)) ||
+            std::memcmp(magic, LOG_MAGIC, sizeof(magic)) != 0) {
+            ::close(file);
+            return false;
+        }
+    }
+
+    fd = file;
+    failed = false;
+    filePath = path;
+    this->generation = generation;
+    markedAt = appendCount();
+    return true;
+}
+
+
+
+void JobLog::close() {
+    if (fd < 0)
+        return;
+
+    commit(appendCount());
+    ::close(fd);
+    fd = -1;
+}
+
+
+
+std::uint64_t JobLog::append(LogOp op, std::string_view name, int priority) {
+    if (fd < 0)
+        return 0;
+
+    char header[RECORD_HEADER];
+    encodeHeader(header, op, name, priority);
+
+    std::lock_guard<std::mutex> guard(lock);
+    pending.insert(pending.end(), header, header + RECORD_HEADER);
+    pending.insert(pending.end(), name.begin(), name.end());
+    return ++appended;
+}
+
+
+
+bool JobLog::commit(std::uint64_t sequence) {
+    if (fd < 0)
+        return sequence == 0;
+
+    std::unique_lock<std::mutex> guard(lock);
+    while (durable < sequence && !failed) {
+        // somebody else is writing. their sync may or may not cover this record, so check again when it's done
+        if (flushing) {
+            flushed.wait(guard);
+            continue;
+        }
+
+        // become the flusher for everything appended so far. new records go to the other buffer meanwhile
+        flushing = true;
+        writing.swap(pending);
+        std::uint64_t upTo = appended;
+        guard.unlock();
+
+        bool ok = writeAll(fd, writing.data(), writing.size()) && ::fdatasync(fd) == 0;
+        writing.clear();
+
+        guard.lock();
+        syncs++;
+        if (ok)
+            durable = upTo;
+        else
+            failed = true;
+        flushing = false;
+        flushed.notify_all();
+    }
+    return durable >= sequence;
+}
+
+
+
+std::uint64_t JobLog::syncCount() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return syncs;
+}
+
+
+
+std::uint64_t JobLog::appendCount() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return appended;
+}
+
+
+
+bool JobLog::markSnapshot() {
+    if (fd < 0)
+        return false;
+
+    std::uint32_t next = generation + 1;
+    std::uint64_t sequence = append(LogOp::Snapshot, {}, static_cast<int>(next));
+    if (!commit(sequence))
+        return false;
+    generation = next;
+    markedAt = sequence;
+    return true;
+}
+
+
+
+bool JobLog::restart() {
+    if (fd < 0 || generation == 0 || appendCount() != markedAt)
+        return false;
+
+    char marker[RECORD_HEADER];
+    encodeHeader(marker, LogOp::Snapshot, {}, static_cast<int>(generation));
+
+    // the new log has to be complete and on disk before it replaces the old one
+    std::string temporary = filePath + ".tmp";
+    int file = ::open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (file < 0)
+        return false;
+    if (!writeAll(file, LOG_MAGIC, sizeof(LOG_MAGIC)) || !writeAll(file, marker, RECORD_HEADER) ||
+        ::fsync(file) != 0 || ::rename(temporary.c_str(), filePath.c_str()) != 0) {
+        ::close(file);
+        ::unlink(temporary.c_str());
+        return false;
+    }
+
+    // the old file is gone from the directory now, appends go to the new one
+    std::lock_guard<std::mutex> guard(lock);
+    ::close(fd);
+    fd = file;
+    return true;
+}
+
+
+
+// helper for reading the whole log at 'path' into 'data'. a damaged record at the end is cut off, both from 'data'
+// and from the file, so new records can follow the last good one. a missing file leaves 'data' empty.
+// returns false if the file can't be read or isn't a job log
+static bool readRecords(const std::string &path, std::vector<char> &data) {
+    data.clear();
+
+    int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file < 0)
+        return errno == ENOENT;
+
+    // the whole log is read at once, it is replayed from memory
+    struct stat info {};
+    if (::fstat(file, &info) != 0) {
+        ::close(file);
+        return false;
+    }
+    data.resize(static_cast<std::size_t>(info.st_size));
+    std::size_t filled = 0;
+    while (filled < data.size()) {
+        ssize_t got = ::read(file, data.data() + filled, data.size() - filled);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got < 0) {
+            ::close(file);
+            return false;
+        }
+        if (got == 0)
+            break;
+        filled += static_cast<std::size_t>(got);
+    }
+    ::close(file);
+    data.resize(filled);
+
+    if (data.empty())
+        return true;
+    if (data.size() < sizeof(LOG_MAGIC) || std::memcmp(data.data(), LOG_MAGIC, sizeof(LOG_MAGIC)) != 0)
+        return false;
+
+    std::size_t pos = sizeof(LOG_MAGIC);
+    while (data.size() - pos >= RECORD_HEADER) {
+        const char *record = data.data() + pos;
+        std::uint32_t sum;
+        std::uint32_t length;
+        std::memcpy(&sum, record, 4);
+        std::memcpy(&length, record + 9, 4);
+        if (length > data.size() - pos - RECORD_HEADER || checksum(record + 4, RECORD_HEADER - 4 + length) != sum)
+            break;
+        pos += RECORD_HEADER + length;
+    }
+
+    // whatever follows the last good record was never committed, so it goes
+    if (pos < data.size()) {
+        if (::truncate(path.c_str(), static_cast<off_t>(pos)) != 0)
+            return false;
+        data.resize(pos);
+    }
+    return true;
+}
+
+
+
+// helper for calling 'visit(op, name, priority, end)' for every record in 'data' from 'pos' on, where 'end' is
+// the offset right after the record. the records have been checked by readRecords
+template<typename Visit>
+static void forEachRecord(const std::vector<char> &data, std::size_t pos, Visit visit) {
+    while (pos < data.size()) {
+        const char *record = data.data() + pos;
+        std::uint32_t length;
+        int priority;
+        std::memcpy(&priority, record + 5, 4);
+        std::memcpy(&length, record + 9, 4);
+        pos += RECORD_HEADER + length;
+        visit(static_cast<LogOp>(record[4]), std::string_view(record + RECORD_HEADER, length), priority, pos);
+    }
+}
+
+
+
+// helper for finding where the changes after snapshot 'generation' start in 'data': after the last marker of that
+// generation, or after the magic for generation 0. a log that starts with a marker was started over after a
+// snapshot, so it can't be replayed from its beginning. returns false if there is no such place
+static bool findTail(const std::vector<char> &data, std::uint32_t generation, std::size_t &start) {
+    if (data.empty()) {
+        start = 0;
+        return generation == 0;
+    }
+
+    bool restarted = data.size() > sizeof(LOG_MAGIC) && static_cast<LogOp>(data[sizeof(LOG_MAGIC) + 4]) == LogOp::Snapshot;
+    if (generation == 0) {
+        start = sizeof(LOG_MAGIC);
+        return !restarted;
+    }
+
+    bool found = false;
+    forEachRecord(data, sizeof(LOG_MAGIC), [&](LogOp op, std::string_view, int priority, std::size_t end) {
+        if (op == LogOp::Snapshot && static_cast<std::uint32_t>(priority) == generation) {
+            start = end;
+            found = true;
+        }
+    });
+    return found;
+}
+
+
+
+bool readJobLog(const std::string &path, std::vector<PrintJob> &jobs) {
+    jobs.clear();
+
+    std::vector<char> data;
+    std::size_t start;
+    if (!readRecords(path, data) || !findTail(data, 0, start))
+        return false;
+
+    // every job inserted so far, with names pointing into 'data', and the entry of every job still queued by name.
+    // a job that leaves only loses its index entry, so nothing is ever moved
+    struct Entry {
+        std::string_view name;
+        int priority;
+        bool queued;
+    };
+    std::vector<Entry> entries;
+    NameIndex queued;
+    queued.reserve(data.size() / (RECORD_HEADER + 8));
+
+    forEachRecord(data, start, [&](LogOp op, std::string_view name, int priority, std::size_t) {
+        std::uint32_t entry = queued.find(name);
+        switch (op) {
+            case LogOp::Insert:
+                if (entry == NameIndex::NOT_FOUND) {
+                    queued.insert(name, static_cast<std::uint32_t>(entries.size()));
+                    entries.push_back({name, priority, true});
+                }
+                break;
+            case LogOp::Update:
+                if (entry != NameIndex::NOT_FOUND)
+                    entries[entry].priority = priority;
+                break;
+            case LogOp::Pop:
+            case LogOp::Cancel:
+                if (entry != NameIndex::NOT_FOUND) {
+                    queued.erase(name);
+                    entries[entry].queued = false;
+                }
+                break;
+            case LogOp::Snapshot:
+                break;
+        }
+    });
+
+    jobs.reserve(queued.size());
+    for (const auto &entry : entries) {
+        if (entry.queued)
+            jobs.emplace_back(std::string(entry.name), entry.priority);
+    }
+    return true;
+}
+
+
+
+bool readJobLogTail(const std::string &path, std::uint32_t generation, std::vector<LogChange> &changes) {
+    changes.clear();
+
+    std::vector<char> data;
+    std::size_t start;
+    if (!readRecords(path, data) || !findTail(data, generation, start))
+        return false;
+
+    // the records are reduced to one change per job on a table of names, like in readJobLog. a job whose first
+    // record is an insert wasn't in the snapshot, any other job was. markers of snapshots that were never saved,
+    // or of older ones, change nothing
+    struct Entry {
+        std::string_view name;
+        int priority;
+        bool inSnapshot;
+        bool queued;
+    };
+    std::vector<Entry> entries;
+    NameIndex seen;
+    seen.reserve((data.size() - start) / (RECORD_HEADER + 8));
+
+    forEachRecord(data, start, [&](LogOp op, std::string_view name, int priority, std::size_t) {
+        if (op == LogOp::Snapshot)
+            return;
+        std::uint32_t entry = seen.find(name);
+        if (entry == NameIndex::NOT_FOUND) {
+            entry = static_cast<std::uint32_t>(entries.size());
+            seen.insert(name, entry);
+            entries.push_back({name, priority, op != LogOp::Insert, true});
+        }
+        switch (op) {
+            case LogOp::Insert:
+            case LogOp::Update:
+                entries[entry].priority = priority;
+                entries[entry].queued = true;
+                break;
+            case LogOp::Pop:
+            case LogOp::Cancel:
+                entries[entry].queued = false;
+                break;
+            case LogOp::Snapshot:
+                break;
+        }
+    });
+
+    for (const auto &entry : entries) {
+        if (entry.inSnapshot)
+            changes.push_back({entry.queued ? LogOp::Update : LogOp::Cancel, std::string(entry.name), entry.priority});
+        else if (entry.queued)
+            changes.push_back({LogOp::Insert, std::string(entry.name), entry.priority});
+    }
+    return true;
+}
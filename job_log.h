@@ -0,0 +1,138 @@
+#ifndef MAXHEAP_JOB_LOG_H
+#define MAXHEAP_JOB_LOG_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "print_job.h"
+
+
+
+// kinds of changes recorded in the job log
+enum class LogOp : std::uint8_t {
+    Insert = 1,
+    Pop = 2,
+    Update = 3,
+    Cancel = 4,
+
+    // not a change: marks where a snapshot of the queue was taken. the priority holds the snapshot's generation
+    Snapshot = 5,
+};
+
+
+
+// append-only binary log of every change made to a print queue, so the queue can be rebuilt after a crash.
+//
+// the file starts with a short magic header, followed by one record per change:
+//   u32 checksum, u8 op, i32 priority, u32 name length, name bytes
+// in native byte order. the checksum covers everything after it, so a record that was only partly written
+// when the program died is recognized, and the log is cut off before it on recovery.
+//
+// appending only copies the record into a buffer. commit() then makes it durable with group commit: the first
+// caller that finds nobody flushing writes out the whole buffer and syncs it, while callers arriving meanwhile
+// keep appending to a fresh buffer and wait. when the sync returns, every record that was in the flushed buffer
+// is durable, so one sync covers everyone who was waiting. callers never hold the lock during the write or sync.
+//
+// with snapshots (see snapshot.h), the log only has to hold what happened after the last one: a snapshot is marked
+// in the log, saved, and then the log starts over as a file that holds just that marker
+class JobLog {
+public:
+    JobLog() = default;
+    ~JobLog();
+
+    JobLog(const JobLog &) = delete;
+    JobLog &operator=(const JobLog &) = delete;
+
+    // open (or create) the log at 'path' for appending. 'generation' is the snapshot it continues from, 0 for none.
+    // returns false if the file can't be opened, or if it isn't a job log. recover the file with readJobLog
+    // (or readJobLogTail) before opening it
+    bool open(const std::string &path, std::uint32_t generation = 0);
+
+    // sync anything not committed yet, and close the file
+    void close();
+
+    bool isOpen() const { return fd >= 0; }
+
+    // path the log was opened at
+    const std::string &path() const { return filePath; }
+
+    // add a record to the buffer. returns its sequence number to pass to commit, or 0 if the log isn't open
+    std::uint64_t append(LogOp op, std::string_view name, int priority);
+
+    // wait until the record with sequence number 'sequence', and everything before it, is on disk.
+    // returns false if writing or syncing the log failed
+    bool commit(std::uint64_t sequence);
+
+    // number of syncs done so far, and of records appended
+    std::uint64_t syncCount() const;
+    std::uint64_t appendCount() const;
+
+    // generation of the last snapshot marked in the log, and the number of records appended since
+    std::uint32_t snapshotGeneration() const { return generation; }
+    std::uint64_t appendedSinceSnapshot() const { return appendCount() - markedAt; }
+
+    // mark the next snapshot generation in the log, after everything appended so far, and wait until the marker is
+    // on disk. the snapshot itself is saved after this, as generation snapshotGeneration(). returns false if the
+    // marker couldn't be written, the generation stays the same then
+    bool markSnapshot();
+
+    // start the log over once the marked snapshot is saved, as a new file that holds only its marker. the new file
+    // is written next to the log and renamed over it, so a crash leaves either log, and both go with the snapshot.
+    // nothing may be appended between markSnapshot and this. returns false if the log is kept as it was
+    bool restart();
+
+private:
+    int fd = -1;
+    std::string filePath;
+
+    // generation of the last snapshot marker, and the value of 'appended' when it was written
+    std::uint32_t generation = 0;
+    std::uint64_t markedAt = 0;
+
+    mutable std::mutex lock;
+    std::condition_variable flushed;
+
+    // records appended since the last flush started, and the buffer being written by the flushing thread
+    std::vector<char> pending;
+    std::vector<char> writing;
+
+    // sequence number of the last record appended, and of the last one known to be on disk
+    std::uint64_t appended = 0;
+    std::uint64_t durable = 0;
+
+    bool flushing = false;
+    bool failed = false;
+    std::uint64_t syncs = 0;
+};
+
+
+
+// read the log at 'path', and put the jobs that were still queued at its end into 'jobs', in no particular order.
+// the changes are replayed on a plain table of names, not on a heap, so the caller can build the heap in one go
+// (see loadJobs in job_queue.h). a damaged record at the end is cut off the file, so new records can follow the
+// last good one. a missing file is an empty log. returns false if the file exists but isn't a job log, or if it
+// was started over after a snapshot, so the jobs from before that are only in the snapshot
+bool readJobLog(const std::string &path, std::vector<PrintJob> &jobs);
+
+
+
+// one change read back from the log
+struct LogChange {
+    LogOp op;
+    std::string name;
+    int priority;
+};
+
+// read what changed after snapshot 'generation' from the log at 'path' into 'changes', to be applied to the queue
+// loaded from that snapshot (see applyLogChanges in snapshot.h). the changes are the records after the last marker
+// of that generation, or all of them for generation 0, reduced to one per job: Insert for a job that wasn't in the
+// snapshot and is still queued, Update with its last priority for one that was and still is, and Cancel for one
+// that was and isn't any more. a damaged record at the end is cut off the file, like with readJobLog.
+// returns false if the file can't be read, isn't a job log, or doesn't go with the snapshot
+bool readJobLogTail(const std::string &path, std::uint32_t generation, std::vector<LogChange> &changes);
+
+#endif // MAXHEAP_JOB_LOG_H
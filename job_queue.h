@@ -0,0 +1,47 @@
+#ifndef MAXHEAP_JOB_QUEUE_H
+#define MAXHEAP_JOB_QUEUE_H
+
+#include <vector>
+
+#include "print_job.h"
+
+// the queue backend used by the program, picked at compile time with MAXHEAP_BACKEND in CMake.
+// every backend offers the same functions (pushJob, popJob, peekJob, changePriority, removeJob, topK, jobName)
+#if MAXHEAP_PAIRING_HEAP
+#include "pairing_queue.h"
+using JobQueue = PairingQueue;
+#elif MAXHEAP_BUCKET_QUEUE
+#include "bucket_queue.h"
+using JobQueue = BucketQueue;
+#elif MAXHEAP_BOUNDED_QUEUE
+#include "bounded_queue.h"
+using JobQueue = BoundedQueue;
+#elif MAXHEAP_AGING_QUEUE
+#include "aging_queue.h"
+using JobQueue = AgingQueue;
+#elif MAXHEAP_MAPPED_QUEUE
+#include "mapped_queue.h"
+using JobQueue = MappedQueue;
+#else
+#include "print_queue.h"
+using JobQueue = PrintQueue;
+// only the d-ary heap can be saved as a snapshot (see snapshot.h), the other backends replay their whole log
+#define MAXHEAP_SNAPSHOTS 1
+#endif
+
+
+
+// add a whole list of jobs to an empty queue in one go, e.g. after reading them back from a log or snapshot.
+// backends with insertBatch build their heap bottom-up in O(n), the others take the jobs one at a time
+template<typename Queue>
+void loadJobs(Queue &jobs, const std::vector<PrintJob> &batch) {
+    if constexpr (requires { insertBatch(jobs, batch); }) {
+        insertBatch(jobs, batch);
+    } else {
+        reserveJobs(jobs, jobs.size() + static_cast<int>(batch.size()));
+        for (const auto &job : batch)
+            pushJob(jobs, job.name, job.priority);
+    }
+}
+
+#endif // MAXHEAP_JOB_QUEUE_H
@@ -1,184 +1,304 @@
 #include <iostream>                     // Assignment Group 34
 #include <vector>
 #include <limits> // for std::numeric_limits
-#include <unordered_set>
-#include <algorithm> // for std::reverse
-
-
+#include <string_view>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "job_queue.h"
+#include "job_log.h"
+#include "batch_reader.h"
+#include "output_sink.h"
+#include "trace.h"
+#include "op_stats.h"
+#if MAXHEAP_SNAPSHOTS
+#include "snapshot.h"
+#endif
+
+
+
+// function to record a change in the job log (if one is open), and wait until it is on disk
+void logChange(OutputSink &out, JobLog &log, LogOp op, const std::string &name, int priority) {
+    if (!log.commit(log.append(op, name, priority)))
+        out << "Warning: could not write to the job log.\n";
+}
 
-// structure to represent a print job
-struct PrintJob {
-    std::string name;
-    int priority;
 
-    PrintJob (std::string name, int priority)
-    : name(std::move(name)), priority(priority) {}
-};
 
+#if MAXHEAP_SNAPSHOTS
+// changes logged after a snapshot before the next one is taken, so a restart never replays more than this
+constexpr std::uint64_t SNAPSHOT_RECORDS = 100000;
 
 
-// init an unordered set to ensure unique names and O(1) lookup time
-// this set will be used to avoid duplicate print jobs
-std::unordered_set<std::string> jobNames;
 
+// helper function for the file the snapshots of the queue logged at 'logPath' go to
+std::string snapshotPath(const std::string &logPath) {
+    return logPath + ".snapshot";
+}
 
 
-// function for restoring max-heap properties on a subtree rooted at i based on priority.
-void heapify(std::vector<PrintJob> &jobs, int n, int parent)  {
-    // start by assuming the parent has the highest priority
-    int largest = parent;
-    int left, right;
 
-    // in a heap, children can be found at this index:
-    left = 2 * parent + 1;
-    right = 2 * parent + 2;
+// function to snapshot the queue once SNAPSHOT_RECORDS changes were logged since the last snapshot, and start the
+// log over after it. if the snapshot can't be saved the log just keeps growing, until the next try
+void snapshotIfDue(OutputSink &errors, const JobQueue &jobs, JobLog &log) {
+    if (!log.isOpen() || log.appendedSinceSnapshot() < SNAPSHOT_RECORDS)
+        return;
 
-    // if left child is greater than parent, and also within bounds, it should also be the 'largest'
-    if(left < n && jobs[left].priority > jobs[largest].priority)
-        // update largest if true
-        largest = left;
+    // a marker that can't be written means the log itself failed, which is reported where it is written
+    if (!log.markSnapshot())
+        return;
+    if (!saveSnapshot(jobs, snapshotPath(log.path()), log.snapshotGeneration()) || !log.restart())
+        errors << "Warning: could not take a snapshot of the print queue.\n";
+}
+#endif
 
-    // if right child is greater than parent, and within bounds
-    if(right < n && jobs[right].priority > jobs[largest].priority)
-        largest = right;
 
-    // the largest should be at index i
-    if(largest != parent){
-        std::swap(jobs[largest], jobs[parent]);
 
-        // recursively heapify the affected subtree to ensure subtree rooted at 'largest' is also a heap
-        heapify(jobs, n, largest);
+// function to insert a node to max-heap
+bool insertNode(OutputSink &out, JobQueue &jobs, JobLog &log, TraceRecorder &trace, const std::string &name, const int priority) {
+    OpTimer timer(StatOp::InsertNode);
+    trace.record(TraceOp::Insert, name, priority);
+#if MAXHEAP_BOUNDED_QUEUE
+    // a bounded queue makes room by dropping its lowest job, or refuses a job that would be the lowest itself
+    PrintJob evicted;
+    switch (offerJob(jobs, name, priority, evicted)) {
+        case OfferResult::Added:
+            logChange(out, log, LogOp::Insert, name, priority);
+            return true;
+        case OfferResult::Evicted:
+            out << "Queue is full, dropped job: " << evicted.name <<
+            " (Priority: " << evicted.priority << ")\n";
+            logChange(out, log, LogOp::Cancel, evicted.name, evicted.priority);
+            logChange(out, log, LogOp::Insert, name, priority);
+            return true;
+        case OfferResult::TooLow:
+            out << "Error: Queue is full, and \"" << name << "\" has no higher priority than any queued job.\n";
+            return false;
+        case OfferResult::Duplicate:
+            break;
+    }
+    out << "Error: A job with the name \"" << name << "\" already exists.\n";
+    return false;
+#else
+    if (!pushJob(jobs, name, priority)) {
+        out << "Error: A job with the name \"" << name << "\" already exists.\n";
+        return false;
     }
+    logChange(out, log, LogOp::Insert, name, priority);
+    return true;
+#endif
 }
 
 
 
+// function to process job with the highest priority, and restore heap properties afterward
+void processHighestPriorityJob(OutputSink &out, JobQueue &jobs, JobLog &log, TraceRecorder &trace) {
+    OpTimer timer(StatOp::ProcessJob);
+    PrintJob highestPriorityJob;
+    trace.record(TraceOp::Pop);
 
-// function to restore heap properties after inserting a new node
-void heapifyInsertOperation(std::vector<PrintJob> &jobs, int i) {
-    int parent = (i - 1) / 2;       // Note: a decimal gets rounded down if stored as an int
+    if (!popJob(jobs, highestPriorityJob)) {
+        out << "No jobs to process.\n";
+        return;
+    }
+    logChange(out, log, LogOp::Pop, highestPriorityJob.name, highestPriorityJob.priority);
+    out << "Printing job: " << highestPriorityJob.name <<
+    " (Priority: " << highestPriorityJob.priority << ")\n";
+
+#if MAXHEAP_AGING_QUEUE
+    // every printed job is one tick, so the jobs still waiting move up
+    advanceEpoch(jobs);
+#endif
+}
 
-    // check if parent is not root node
-    if(parent >= 0 && jobs[parent].priority < jobs[i].priority) {
 
-        // if priority of parent is smaller than new node's priority, swap to restore heap properties
-        std::swap(jobs[parent], jobs[i]);
 
-        // recursively call the same operation to the new parent node.
-        heapifyInsertOperation(jobs, parent);
+// function for editing an existing job's priority
+void updateJobPriority(OutputSink &out, JobQueue &jobs, JobLog &log, TraceRecorder &trace, const std::string &name, int new_priority) {
+    OpTimer timer(StatOp::UpdatePriority);
+    trace.record(TraceOp::Update, name, new_priority);
+    if (!changePriority(jobs, name, new_priority)) {
+        out << "Error: No job found with name \"" << name << "\".\n";
+        return;
     }
-    // do nothing if parent has greater or equal priority than new node
+    logChange(out, log, LogOp::Update, name, new_priority);
+    out << "Priority of \"" << name << "\" is updated to " << new_priority << ".\n";
 }
 
 
 
-// function to insert a node to max-heap
-bool insertNode(std::vector<PrintJob> &jobs, const std::string &name, const int priority) {
-    if (jobNames.find(name) != jobNames.end()) {
-        std::cout << "Error: A job with the name \"" << name << "\" already exists." << std::endl;
-        return false;
+// function for cancelling a queued job, wherever it is in the queue
+void cancelPrintJob(OutputSink &out, JobQueue &jobs, JobLog &log, TraceRecorder &trace, const std::string &name) {
+    OpTimer timer(StatOp::CancelJob);
+    trace.record(TraceOp::Cancel, name);
+    if (!removeJob(jobs, name)) {
+        out << "Error: No job found with name \"" << name << "\".\n";
+        return;
     }
+    logChange(out, log, LogOp::Cancel, name, 0);
+    out << "Job \"" << name << "\" is cancelled.\n";
+}
 
-    // insert new job at bottom of heap
-    jobs.emplace_back(name, priority);
-    jobNames.insert(name);
 
-    // call function to restore heap properties, starting from newly inserted node at index = jobs.size() - 1
-    heapifyInsertOperation(jobs, static_cast<int>(jobs.size() - 1));
-    return true;
-}
 
+// number of jobs that fit on one screen, shown after a priority update
+constexpr int JOBS_PER_SCREEN = 20;
 
 
-// function to process job with the highest priority, and restore heap properties afterward
-void processHighestPriorityJob(std::vector<PrintJob> &jobs) {
 
+// function to display jobs in priority order. with a limit, only that many of the highest-priority jobs are shown
+void displayJobs(OutputSink &out, const JobQueue &jobs, TraceRecorder &trace, int limit = -1) {
+    trace.record(TraceOp::Display, {}, limit);
     if (jobs.empty()) {
-        std::cout << "No jobs to process." << std::endl;
+        out << "There are no jobs.\n";
         return;
     }
-    // retrieve the highest-priority job
-    PrintJob highestPriorityJob = jobs.front();
-    std::cout << "Printing job: " << highestPriorityJob.name <<
-    " (Priority: " << highestPriorityJob.priority << ")" << std::endl;
-
-    // move last job in heap to root position, and delete highestPriorityJob from heap
-    jobs[0] = jobs.back();
 
-    // remove the old last job
-    jobs.pop_back();
-
-    // remove the name of highestPriorityJob, to make room to create a new job with identical name
-    jobNames.erase(highestPriorityJob.name);
+    if (limit < 0 || limit > jobs.size())
+        limit = jobs.size();
+
+    // only the root node is guaranteed to be the largest, so walk the heap in order
+    // for just the jobs we show. the heap itself is left as it is
+    out << "\nJobs in priority order (highest to lowest): \n";
+    for(const auto &key : topK(jobs, limit)) {
+        out << "Job name: " << jobName(jobs, key) << ", Job priority: " << key.priority;
+#if MAXHEAP_AGING_QUEUE
+        out << " (" << effectivePriority(jobs, key.id) << " with waiting time)";
+#endif
+        out << '\n';
+    }
 
-    // call heapify on root node to restore max-heap properties.
-    heapify(jobs, static_cast<int>(jobs.size()), 0);
+    if (limit < jobs.size())
+        out << "... and " << jobs.size() - limit << " more.\n";
 }
 
 
 
-// function for editing an existing job's priority
-void updateJobPriority(std::vector<PrintJob> &jobs, const std::string &name, int new_priority) {
-    // set index to a position that I define as not found
-    int index = -1;
-    for (int i = 0; i < jobs.size(); i++) {
-        if (jobs[i].name == name) {
-
-            // if found, set index to position of job object to edit
-            index = i;
-            break;
-        }
-    }
-    if (index == -1) {
-        std::cout << "Error: No job found with name \"" << name << "\"." << std::endl;
-        return;
-    }
-
-    int old_priority = jobs[index].priority;
-    jobs[index].priority = new_priority;
+// records the batch mode writes to the job log before waiting for them to be on disk
+constexpr std::uint64_t LOG_GROUP_RECORDS = 1024;
 
-    if (new_priority > old_priority) {
-        heapifyInsertOperation(jobs, index);
-    } else {
-        heapify(jobs, static_cast<int>(jobs.size()), index);
-    }
-    std::cout << "Priority of \"" << name << "\" is updated to " << new_priority << "." << std::endl;
-}
 
 
-// function to perform heap sort on the jobs vector.
-void heapSort(std::vector<PrintJob> &jobs, int n) {
-    // loop from last element to first
-    for(int i = n - 1; i >= 0; i--){
-        // swap root node (largest element) with the current unsorted node.
-        // root node is moved to the back of the list and considered sorted
-        std::swap(jobs[i], jobs[0]);
+// function to run a batch script from 'fd' instead of the menu, one command per line: "I name priority", "P",
+// "U name priority", "C name" or "S" for the operation statistics. every printed job is written as "name priority" on
+// a line of its own, and a command that fails is reported on the error output with its line number, after which the
+// script goes on.
+// the log is committed in groups of up to LOG_GROUP_RECORDS records, and the output of the commands in a group is
+// only written out once the group is on disk, so a crash never loses a change the script already reported.
+// returns false if any command failed or the script couldn't be read
+bool runBatch(OutputSink &out, JobQueue &jobs, JobLog &log, TraceRecorder &trace, int fd) {
+    BatchReader reader(fd);
+    BatchCommand command;
+    PrintJob job;
+    bool ok = true;
 
-        // call heapify to restore max-heap properties for the remaining unsorted nodes
-        heapify(jobs, i, 0);
-    }
-}
+    // problems are collected the same way, and written out at the end
+    OutputSink errors(STDERR_FILENO);
+    auto fail = [&](const char *problem) {
+        errors << "Line " << reader.line() << ": " << problem << '\n';
+        ok = false;
+    };
 
+    std::uint64_t committed = 0;
+    bool logFailed = false;
+    auto commitGroup = [&] {
+        if (!log.commit(log.appendCount()) && !logFailed) {
+            errors << "Warning: could not write to the job log.\n";
+            logFailed = true;
+        }
+#if MAXHEAP_SNAPSHOTS
+        snapshotIfDue(errors, jobs, log);
+#endif
+        committed = log.appendCount();
+        out.flush();
+    };
+
+    // nothing may reach the output before its group is committed, not even when the buffer fills up mid-group
+    out.hold(true);
+
+    while (reader.next(command)) {
+        switch (command.kind) {
+            case BatchCommand::Insert: {
+                OpTimer timer(StatOp::InsertNode);
+                trace.record(TraceOp::Insert, command.name, command.priority);
+#if MAXHEAP_BOUNDED_QUEUE
+                PrintJob evicted;
+                OfferResult result = offerJob(jobs, command.name, command.priority, evicted);
+                if (result == OfferResult::Evicted)
+                    log.append(LogOp::Cancel, evicted.name, evicted.priority);
+                bool added = result == OfferResult::Added || result == OfferResult::Evicted;
+#else
+                bool added = pushJob(jobs, command.name, command.priority);
+#endif
+                if (added)
+                    log.append(LogOp::Insert, command.name, command.priority);
+                else
+                    fail("job not added, the name is taken or the queue is full");
+                break;
+            }
+            case BatchCommand::Pop: {
+                OpTimer timer(StatOp::ProcessJob);
+                trace.record(TraceOp::Pop);
+                if (!popJob(jobs, job)) {
+                    fail("no jobs to process");
+                    break;
+                }
+                log.append(LogOp::Pop, job.name, job.priority);
+                out << job.name << ' ' << job.priority << '\n';
+#if MAXHEAP_AGING_QUEUE
+                advanceEpoch(jobs);
+#endif
+                break;
+            }
+            case BatchCommand::Update: {
+                OpTimer timer(StatOp::UpdatePriority);
+                trace.record(TraceOp::Update, command.name, command.priority);
+                if (changePriority(jobs, command.name, command.priority))
+                    log.append(LogOp::Update, command.name, command.priority);
+                else
+                    fail("no job with that name");
+                break;
+            }
+            case BatchCommand::Cancel: {
+                OpTimer timer(StatOp::CancelJob);
+                trace.record(TraceOp::Cancel, command.name);
+                if (removeJob(jobs, command.name))
+                    log.append(LogOp::Cancel, command.name, 0);
+                else
+                    fail("no job with that name");
+                break;
+            }
+            case BatchCommand::Stats:
+                dumpOpStats(out);
+                break;
+            case BatchCommand::Invalid:
+                fail("not a command");
+                break;
+        }
 
+        // a group ends when it is big enough, or once its output has filled half the buffer, so the held output
+        // stays within the buffer unless a single command prints more than the other half
+        if (log.appendCount() - committed >= LOG_GROUP_RECORDS || out.buffered() >= OutputSink::BUFFER_SIZE / 2)
+            commitGroup();
+    }
 
-// function to display jobs in priority order
-void displayJobs(std::vector<PrintJob> &jobs) {
-    if (jobs.empty()) {
-        std::cout << "There are no jobs." << std::endl;
-        return;
+    if (reader.failed()) {
+        errors << "Error: Can't read the rest of the script.\n";
+        ok = false;
     }
+    commitGroup();
+    out.hold(false);
+    errors.flush();
+    return ok;
+}
 
-    // since only root node is guaranteed to be sorted
-    // we need to call heapSort to sort the other jobs as well
-    heapSort(jobs, static_cast<int>(jobs.size()));
 
-    // reverse the sorted jobs to display in descending order
-    std::reverse(jobs.begin(), jobs.end());
 
-    std::cout << "\nJobs in priority order (highest to lowest): " << std::endl;
-    for(const auto &job : jobs) {
-        std::cout << "Job name: " << job.name << ", Job priority: " << job.priority << std::endl;
-    }
+// helper function for asking for input: everything written so far has to be on the screen before the program waits,
+// so this is where the interactive program flushes its output, once per prompt
+void prompt(OutputSink &out, std::string_view question) {
+    out << question;
+    out.flush();
 }
 
 
@@ -200,26 +320,130 @@ bool getValidInteger(int &number) {
 
 
 
-void displayMenu() {
-    std::cout << "\nPrint Job Scheduling System\n" << std::endl;
-    std::cout << "Choose one of the options:" << std::endl;
-    std::cout << "1. Insert print job" << std::endl;
-    std::cout << "2. Display next print job (print job with highest priority)" << std::endl;
-    std::cout << "3. Process next print job" << std::endl;
-    std::cout << "4. Update print job priority" << std::endl;
-    std::cout << "5. Display all print jobs" << std::endl;
-    std::cout << "6. Exit program" << std::endl;
+void displayMenu(OutputSink &out) {
+    out << "\nPrint Job Scheduling System\n\n";
+    out << "Choose one of the options:\n";
+    out << "1. Insert print job\n";
+    out << "2. Display next print job (print job with highest priority)\n";
+    out << "3. Process next print job\n";
+    out << "4. Update print job priority\n";
+    out << "5. Display all print jobs\n";
+    out << "6. Exit program\n";
+    out << "7. Cancel print job\n";
+    out << "8. Show operation statistics\n";
 }
 
 
 
-int main() {
-    std::vector<PrintJob> jobs;
+int main(int argc, char **argv) {
+    JobQueue jobs;
+    JobLog log;
     int choice;
 
+    // arguments: [--batch <script>] [--quiet] [--trace <file>] [--stats] [path]. the script is run instead of the menu,
+    // "-" reads it from the standard input. --quiet drops all regular output, errors are still shown. --trace records
+    // every operation in a trace file, for maxheap_replay. --stats keeps operation statistics in batch mode too
+    const char *script = nullptr;
+    const char *tracePath = nullptr;
+    bool quiet = false;
+    bool stats = false;
+    int arg = 1;
+    for (; arg < argc; arg++) {
+        std::string_view option = argv[arg];
+        if (option == "--batch" && arg + 1 < argc)
+            script = argv[++arg];
+        else if (option == "--quiet")
+            quiet = true;
+        else if (option == "--trace" && arg + 1 < argc)
+            tracePath = argv[++arg];
+        else if (option == "--stats")
+            stats = true;
+        else
+            break;
+    }
+    const char *path = arg < argc ? argv[arg] : nullptr;
+
+    OutputSink out;
+    out.setQuiet(quiet);
+
+    // latencies and work of the main operations are recorded from the start, for the statistics command.
+    // timing every operation costs about a third of a batch run, so there it is only done when asked for
+    enableOpStats(script == nullptr || stats);
+
+#if MAXHEAP_MAPPED_QUEUE
+    // the queue lives in its own files and is still there after a restart, so there is no log to replay.
+    // it is checkpointed when the program exits
+    if (path == nullptr)
+        path = "print_jobs";
+    if (!openJobs(jobs, path)) {
+        std::cerr << "Error: Can't open the print queue in \"" << path << "\"." << std::endl;
+        return 1;
+    }
+    if (script == nullptr)
+        out << "Opened " << jobs.size() << " jobs from \"" << path << "\".\n";
+#else
+    // with a log file given, the queue is rebuilt from it first, and every change is recorded in it
+    if (path != nullptr) {
+        // the queue starts from the last snapshot, if there is one, and only the changes logged after it are read.
+        // without one, the whole log is reduced to the jobs still queued, which are added in one go
+        bool snapshotted = false;
+#if MAXHEAP_SNAPSHOTS
+        std::string snapshot = snapshotPath(path);
+        snapshotted = ::access(snapshot.c_str(), F_OK) == 0;
+        if (snapshotted) {
+            std::uint32_t generation;
+            if (!loadSnapshot(jobs, snapshot, generation)) {
+                std::cerr << "Error: Can't load the snapshot \"" << snapshot << "\"." << std::endl;
+                return 1;
+            }
+            std::vector<LogChange> changes;
+            if (!readJobLogTail(path, generation, changes) || !log.open(path, generation)) {
+                std::cerr << "Error: Can't use \"" << path << "\" as job log." << std::endl;
+                return 1;
+            }
+            applyLogChanges(jobs, changes);
+        }
+#endif
+        if (!snapshotted) {
+            std::vector<PrintJob> recovered;
+            if (!readJobLog(path, recovered) || !log.open(path)) {
+                std::cerr << "Error: Can't use \"" << path << "\" as job log." << std::endl;
+                return 1;
+            }
+            loadJobs(jobs, recovered);
+        }
+        if (script == nullptr)
+            out << "Recovered " << jobs.size() << " jobs from \"" << path << "\".\n";
+    }
+#endif
+
+    // the trace starts with the jobs that were already queued, as inserts, so a replay starts from the same queue
+    TraceRecorder trace;
+    if (tracePath != nullptr) {
+        if (!trace.open(tracePath)) {
+            std::cerr << "Error: Can't create the trace \"" << tracePath << "\"." << std::endl;
+            return 1;
+        }
+        for (const auto &key : topK(jobs, jobs.size()))
+            trace.record(TraceOp::Insert, jobName(jobs, key), key.priority);
+    }
+
+    if (script != nullptr) {
+        int fd = std::string_view(script) == "-" ? STDIN_FILENO : ::open(script, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            std::cerr << "Error: Can't open \"" << script << "\"." << std::endl;
+            return 1;
+        }
+
+        bool ok = runBatch(out, jobs, log, trace, fd);
+        if (fd != STDIN_FILENO)
+            ::close(fd);
+        return ok ? 0 : 1;
+    }
+
     do {
-        displayMenu();
-        std::cout << "Your choice: ";
+        displayMenu(out);
+        prompt(out, "Your choice: ");
         std::cin >> choice;
 
         // handle invalid input for choices
@@ -227,7 +451,7 @@ int main() {
 
             std::cin.clear();
             std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-            std::cout << "Invalid choice." << std::endl;
+            out << "Invalid choice.\n";
         }
 
         switch (choice) {
@@ -235,77 +459,96 @@ int main() {
                 std::string name;
                 int priority;
 
-                std::cout << "Enter job name (only single words are allowed): ";
+                prompt(out, "Enter job name (only single words are allowed): ");
 
                 // get name, and clear rest of input
                 std::cin >> name;
                 std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 
-                std::cout << "Enter job priority: ";
+                prompt(out, "Enter job priority: ");
 
                 // get a valid integer
                 while (!getValidInteger(priority)) {
-                    std::cout << "Invalid input. Please enter a valid integer for priority: ";
+                    prompt(out, "Invalid input. Please enter a valid integer for priority: ");
                 }
 
                 // try to insert node
-                if (insertNode(jobs, name, priority)) {
-                    std::cout << "Job \"" << name << "\" successfully added." << std::endl;
+                if (insertNode(out, jobs, log, trace, name, priority)) {
+                    out << "Job \"" << name << "\" successfully added.\n";
 
-                    if (!jobs.empty()) {
+                    PrintJob next;
+                    if (peekJob(jobs, next)) {
                         // display next print job with highest priority
-                        std::cout << "Highest priority: " << jobs.front().name <<
-                                  " (Priority: " << jobs.front().priority << ")" << std::endl;
+                        out << "Highest priority: " << next.name <<
+                                  " (Priority: " << next.priority << ")\n";
                     } else {
-                        std::cout << "Print queue is now empty." << std::endl;
+                        out << "Print queue is now empty.\n";
                     }
                 }
                 break;
             }
             case 2: {
-                if (!jobs.empty()) {
-                    std::cout << jobs.front().name
-                              << " (Priority: " << jobs.front().priority << ")" << std::endl;
+                PrintJob next;
+                if (peekJob(jobs, next)) {
+                    out << next.name
+                              << " (Priority: " << next.priority << ")\n";
                 } else {
-                    std::cout << "No jobs in queue." << std::endl;
+                    out << "No jobs in queue.\n";
                 }
                 break;
             }
             case 3: {
-                processHighestPriorityJob(jobs);
+                processHighestPriorityJob(out, jobs, log, trace);
                 break;
             }
             case 4: {
                 std::string name;
                 int priority;
 
-                std::cout << "Enter name of job you want to update: ";
+                prompt(out, "Enter name of job you want to update: ");
                 std::cin >> name;
                 std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 
-                std::cout << "Enter new priority: ";
+                prompt(out, "Enter new priority: ");
 
                 while (!getValidInteger(priority)) {
-                    std::cout << "Invalid input. Please enter a valid integer for priority: ";
+                    prompt(out, "Invalid input. Please enter a valid integer for priority: ");
                 }
-                updateJobPriority(jobs, name, priority);
+                updateJobPriority(out, jobs, log, trace, name, priority);
 
-                // display the updated order of the print jobs after priority change
-                displayJobs(jobs);
+                // display the first screen of the updated order after priority change
+                displayJobs(out, jobs, trace, JOBS_PER_SCREEN);
 
                 break;
             }
             case 5: {
-                displayJobs(jobs);
+                displayJobs(out, jobs, trace);
                 break;
             }
             case 6: {
-                std::cout << "Exiting program.." << std::endl;
+                out << "Exiting program..\n";
+                break;
+            }
+            case 7: {
+                std::string name;
+
+                prompt(out, "Enter name of job you want to cancel: ");
+                std::cin >> name;
+                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+
+                cancelPrintJob(out, jobs, log, trace, name);
+                break;
+            }
+            case 8: {
+                dumpOpStats(out);
                 break;
             }
             default:
-                std::cout << "Try choosing one of the options 1-6." << std::endl;
+                out << "Try choosing one of the options 1-8.\n";
         }
+#if MAXHEAP_SNAPSHOTS
+        snapshotIfDue(out, jobs, log);
+#endif
     } while (choice != 6);
 
     return 0;
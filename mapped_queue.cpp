@@ -0,0 +1,448 @@
+#include "mapped_queue.h"
+
+#include <algorithm> // for std::min, std::max, std::sort, std::fill
+#include <atomic>    // for std::atomic_signal_fence
+
+
+
+// meta words of the job record file, see MappedFileHeader
+enum : int {
+    // 1 while the queue is dirty, see MappedQueue
+    RECORDS_DIRTY = 0,
+
+    // id of the first free record + 1, or 0 if there is none
+    RECORDS_FREE_LIST = 1,
+};
+
+// meta word of the name file: bytes of names that belong to no queued job anymore
+static constexpr int NAMES_DEAD_BYTES = 0;
+
+// the name region is compacted once it has at least this many dead bytes, and more dead than live ones
+static constexpr std::uint64_t MIN_COMPACT_BYTES = 64 * 1024;
+
+// id of an empty index slot
+static constexpr JobId NO_ID = UINT32_MAX;
+
+
+
+// 32-bit FNV-1a. the hashes are stored in the files, so unlike std::hash this has to be the same in every build
+static std::uint32_t hashName(std::string_view name) {
+    std::uint32_t hash = 2166136261u;
+    for (char c : name) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+
+
+// name of the job in a record
+static std::string_view recordName(const MappedQueue &jobs, const MappedRecord &record) {
+    return {jobs.names.data() + record.nameOffset, record.nameLength};
+}
+
+
+
+// keeps the compiler from moving writes to the files across it, where a repair relies on their order
+static void writeBarrier() {
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
+
+
+// helper for recording the new index of a key that was moved inside the heap
+static void keyPlaced(MappedQueue &jobs, int i) {
+    jobs.records[jobs.heap[i].id].position = i;
+}
+
+
+
+// mark the files dirty before the first change after opening or a checkpoint. the mark is synced, so it is on disk
+// before any of the changes can be
+static void markDirty(MappedQueue &jobs) {
+    if (jobs.dirty)
+        return;
+    jobs.records.meta(RECORDS_DIRTY) = 1;
+    jobs.records.syncHeader();
+    jobs.dirty = true;
+}
+
+
+
+// index of the slot holding 'name', or the empty slot where it would go. the index must not be empty
+static std::size_t findSlot(const MappedQueue &jobs, std::string_view name, std::uint32_t hash) {
+    std::size_t mask = jobs.index.size() - 1;
+    std::size_t i = hash & mask;
+    while (jobs.index[i].id != NO_ID) {
+        const MappedSlot &slot = jobs.index[i];
+        if (slot.hash == hash && recordName(jobs, jobs.records[slot.id]) == name)
+            return i;
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+
+
+// id of the queued job called 'name', or NO_ID
+static JobId findJob(const MappedQueue &jobs, std::string_view name, std::uint32_t hash) {
+    if (jobs.index.empty())
+        return NO_ID;
+    return jobs.index[findSlot(jobs, name, hash)].id;
+}
+
+
+
+// put a job into the first free slot from its hash on. the job must not be in the index yet
+static void placeSlot(MappedQueue &jobs, std::uint32_t hash, JobId id) {
+    std::size_t mask = jobs.index.size() - 1;
+    std::size_t i = hash & mask;
+    while (jobs.index[i].id != NO_ID)
+        i = (i + 1) & mask;
+    jobs.index[i] = {hash, id};
+}
+
+
+
+// remove the entry in slot 'hole', with backward shift deletion like NameIndex::erase
+static void eraseSlot(MappedQueue &jobs, std::size_t hole) {
+    std::size_t mask = jobs.index.size() - 1;
+    std::size_t i = hole;
+    while (true) {
+        i = (i + 1) & mask;
+        if (jobs.index[i].id == NO_ID)
+            break;
+
+        std::size_t home = jobs.index[i].hash & mask;
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            jobs.index[hole] = jobs.index[i];
+            hole = i;
+        }
+    }
+    jobs.index[hole] = MappedSlot();
+}
+
+
+
+// index slots needed for 'n' jobs, keeping the table at most 3/4 full
+static std::size_t indexCapacity(std::size_t n) {
+    std::size_t capacity = 16;
+    while (capacity * 3 < n * 4)
+        capacity *= 2;
+    return capacity;
+}
+
+
+
+// refill the index with 'capacity' slots from the keys in the heap
+static bool rebuildIndex(MappedQueue &jobs, std::size_t capacity) {
+    if (!jobs.index.resize(capacity))
+        return false;
+    std::fill(jobs.index.data(), jobs.index.data() + capacity, MappedSlot());
+    for (std::size_t i = 0; i < jobs.heap.size(); i++) {
+        JobId id = jobs.heap[i].id;
+        placeSlot(jobs, jobs.records[id].hash, id);
+    }
+    return true;
+}
+
+
+
+// grow the index if it can't take 'n' jobs
+static bool reserveIndex(MappedQueue &jobs, std::size_t n) {
+    if (n * 4 <= jobs.index.size() * 3)
+        return true;
+    return rebuildIndex(jobs, std::max(indexCapacity(n), jobs.index.size() * 2));
+}
+
+
+
+// move the names of queued jobs down over the space of finished ones, in the order they are stored in.
+// a name only moves into a gap at least as long as itself, and its record is updated after the copy,
+// so every record points at an intact copy of its name at any moment, even if the program dies halfway
+static void compactNames(MappedQueue &jobs) {
+    std::vector<JobId> order;
+    order.reserve(jobs.heap.size());
+    for (std::size_t i = 0; i < jobs.heap.size(); i++)
+        order.push_back(jobs.heap[i].id);
+    std::sort(order.begin(), order.end(), [&](JobId a, JobId b) {
+        return jobs.records[a].nameOffset < jobs.records[b].nameOffset;
+    });
+
+    std::uint64_t end = 0;
+    std::uint64_t liveBytes = 0;
+    for (JobId id : order) {
+        MappedRecord &record = jobs.records[id];
+        if (record.nameOffset - end >= record.nameLength) {
+            std::copy_n(jobs.names.data() + record.nameOffset, record.nameLength, jobs.names.data() + end);
+            writeBarrier();
+            record.nameOffset = end;
+        }
+        end = record.nameOffset + record.nameLength;
+        liveBytes += record.nameLength;
+    }
+
+    jobs.names.resize(end);
+    jobs.names.meta(NAMES_DEAD_BYTES) = end - liveBytes;
+}
+
+
+
+// put a job whose key left the heap on the free list, and forget its name
+static void retireJob(MappedQueue &jobs, JobId id) {
+    MappedRecord &record = jobs.records[id];
+    eraseSlot(jobs, findSlot(jobs, recordName(jobs, record), record.hash));
+    jobs.names.meta(NAMES_DEAD_BYTES) += record.nameLength;
+
+    record.position = -1;
+    record.nameOffset = jobs.records.meta(RECORDS_FREE_LIST);
+    jobs.records.meta(RECORDS_FREE_LIST) = id + 1;
+
+    std::uint64_t dead = jobs.names.meta(NAMES_DEAD_BYTES);
+    if (jobs.heap.empty()) {
+        jobs.names.clear();
+        jobs.names.meta(NAMES_DEAD_BYTES) = 0;
+    } else if (dead >= MIN_COMPACT_BYTES && dead * 2 > jobs.names.size()) {
+        compactNames(jobs);
+    }
+}
+
+
+
+// rebuild the heap, the free list and the name index from the job records, for a queue that was left dirty.
+// a record counts as queued if it has a heap position and its name is inside the name region
+static bool repairJobs(MappedQueue &jobs) {
+    jobs.heap.clear();
+    if (!jobs.heap.reserve(jobs.records.size()))
+        return false;
+
+    // going down, so the free list hands out the lowest ids first
+    std::uint64_t freeList = 0;
+    std::uint64_t liveBytes = 0;
+    for (std::size_t id = jobs.records.size(); id-- > 0;) {
+        MappedRecord &record = jobs.records[id];
+        if (record.position >= 0 && record.nameOffset + record.nameLength <= jobs.names.size()) {
+            record.position = static_cast<int>(jobs.heap.size());
+            jobs.heap.push_back({record.priority, static_cast<JobId>(id)});
+            liveBytes += record.nameLength;
+        } else {
+            record.position = -1;
+            record.nameOffset = freeList;
+            freeList = id + 1;
+        }
+    }
+    jobs.records.meta(RECORDS_FREE_LIST) = freeList;
+    jobs.names.meta(NAMES_DEAD_BYTES) = jobs.names.size() - liveBytes;
+
+    buildHeap(jobs.heap, static_cast<int>(jobs.heap.size()), higherKey, [&](int i) { keyPlaced(jobs, i); });
+    return rebuildIndex(jobs, std::max(indexCapacity(jobs.heap.size()), jobs.index.size()));
+}
+
+
+
+MappedQueue::MappedQueue(const std::string &path) {
+    openJobs(*this, path);
+}
+
+
+
+MappedQueue::~MappedQueue() {
+    closeJobs(*this);
+}
+
+
+
+bool openJobs(MappedQueue &jobs, const std::string &path) {
+    closeJobs(jobs);
+
+    bool ok = jobs.heap.open(path + ".heap") && jobs.records.open(path + ".jobs") &&
+              jobs.index.open(path + ".index") && jobs.names.open(path + ".names");
+
+    // a queue that wasn't checkpointed last time, or whose files don't fit together, is repaired from its records
+    std::size_t slots = jobs.index.size();
+    if (ok && (jobs.records.meta(RECORDS_DIRTY) != 0 || jobs.heap.size() > jobs.records.size() ||
+               (slots & (slots - 1)) != 0 || jobs.heap.size() * 4 > slots * 3)) {
+        jobs.dirty = true;
+        ok = repairJobs(jobs) && checkpointJobs(jobs);
+    }
+
+    if (!ok) {
+        jobs.heap.close();
+        jobs.records.close();
+        jobs.index.close();
+        jobs.names.close();
+    }
+    jobs.dirty = false;
+    return ok;
+}
+
+
+
+bool checkpointJobs(MappedQueue &jobs) {
+    if (!jobs.isOpen())
+        return false;
+    if (!jobs.dirty)
+        return true;
+
+    // everything else goes to disk before the clean mark does
+    if (!jobs.heap.sync() || !jobs.records.sync() || !jobs.index.sync() || !jobs.names.sync())
+        return false;
+    jobs.records.meta(RECORDS_DIRTY) = 0;
+    if (!jobs.records.syncHeader())
+        return false;
+
+    jobs.dirty = false;
+    return true;
+}
+
+
+
+void closeJobs(MappedQueue &jobs) {
+    if (!jobs.isOpen())
+        return;
+
+    checkpointJobs(jobs);
+    jobs.heap.close();
+    jobs.records.close();
+    jobs.index.close();
+    jobs.names.close();
+    jobs.dirty = false;
+}
+
+
+
+bool pushJob(MappedQueue &jobs, std::string_view name, int priority) {
+    std::uint32_t hash = hashName(name);
+    if (!jobs.isOpen() || findJob(jobs, name, hash) != NO_ID)
+        return false;
+
+    // make room in all four files first, so a full disk can't leave a job half added
+    markDirty(jobs);
+    std::size_t n = jobs.heap.size() + 1;
+    std::uint64_t freeList = jobs.records.meta(RECORDS_FREE_LIST);
+    if (!jobs.heap.reserve(n) || (freeList == 0 && !jobs.records.reserve(jobs.records.size() + 1)) ||
+        !jobs.names.reserve(jobs.names.size() + name.size()) || !reserveIndex(jobs, n))
+        return false;
+
+    JobId id;
+    if (freeList != 0) {
+        id = static_cast<JobId>(freeList - 1);
+        jobs.records.meta(RECORDS_FREE_LIST) = jobs.records[id].nameOffset;
+    } else {
+        id = static_cast<JobId>(jobs.records.size());
+        jobs.records.push_back(MappedRecord());
+    }
+
+    MappedRecord record;
+    record.nameOffset = jobs.names.size();
+    record.nameLength = static_cast<std::uint32_t>(name.size());
+    record.hash = hash;
+    record.priority = priority;
+    jobs.names.append(name.data(), name.size());
+    jobs.records[id] = record;
+    placeSlot(jobs, hash, id);
+
+    // the job only counts as queued once its key has a position, and by then its name and record are written
+    writeBarrier();
+    jobs.heap.push_back({priority, id});
+    siftUp(jobs.heap, jobs.size() - 1, higherKey, [&](int i) { keyPlaced(jobs, i); });
+    return true;
+}
+
+
+
+bool popJob(MappedQueue &jobs, PrintJob &job) {
+    if (jobs.empty())
+        return false;
+
+    markDirty(jobs);
+    HeapKey top = popTop(jobs.heap, higherKey, [&](int i) { keyPlaced(jobs, i); });
+
+    const MappedRecord &record = jobs.records[top.id];
+    job.name.assign(recordName(jobs, record));
+    job.priority = record.priority;
+    retireJob(jobs, top.id);
+    return true;
+}
+
+
+
+bool peekJob(const MappedQueue &jobs, PrintJob &job) {
+    if (jobs.empty())
+        return false;
+
+    const MappedRecord &record = jobs.records[jobs.heap.front().id];
+    job.name.assign(recordName(jobs, record));
+    job.priority = record.priority;
+    return true;
+}
+
+
+
+bool changePriority(MappedQueue &jobs, std::string_view name, int new_priority) {
+    JobId id = findJob(jobs, name, hashName(name));
+    if (id == NO_ID)
+        return false;
+
+    markDirty(jobs);
+    MappedRecord &record = jobs.records[id];
+    int index = record.position;
+    int old_priority = record.priority;
+    record.priority = new_priority;
+    jobs.heap[index].priority = new_priority;
+
+    auto placed = [&](int i) { keyPlaced(jobs, i); };
+    if (new_priority > old_priority)
+        siftUp(jobs.heap, index, higherKey, placed);
+    else
+        siftDown(jobs.heap, jobs.size(), index, higherKey, placed);
+    return true;
+}
+
+
+
+bool removeJob(MappedQueue &jobs, std::string_view name) {
+    JobId id = findJob(jobs, name, hashName(name));
+    if (id == NO_ID)
+        return false;
+
+    markDirty(jobs);
+    int index = jobs.records[id].position;
+
+    // the last key fills the hole, and goes up or down from there
+    HeapKey last = jobs.heap.back();
+    jobs.heap.pop_back();
+    if (index < jobs.size()) {
+        jobs.heap[index] = last;
+        auto placed = [&](int i) { keyPlaced(jobs, i); };
+        if (index > 0 && higherKey(last, jobs.heap[DaryLayout<HEAP_ARITY>::parent(index)]))
+            siftUp(jobs.heap, index, higherKey, placed);
+        else
+            siftDown(jobs.heap, jobs.size(), index, higherKey, placed);
+    }
+
+    retireJob(jobs, id);
+    return true;
+}
+
+
+
+void reserveJobs(MappedQueue &jobs, int n) {
+    if (!jobs.isOpen())
+        return;
+
+    markDirty(jobs);
+    jobs.heap.reserve(n);
+    jobs.records.reserve(n);
+    reserveIndex(jobs, n);
+}
+
+
+
+std::vector<HeapKey> topK(const MappedQueue &jobs, int k) {
+    std::vector<HeapKey> keys;
+    keys.reserve(std::min(std::max(k, 0), jobs.size()));
+    visitTopK(jobs.heap, k, higherKey, [&](int i) { keys.push_back(jobs.heap[i]); });
+    return keys;
+}
@@ -0,0 +1,123 @@
+#ifndef MAXHEAP_MAPPED_QUEUE_H
+#define MAXHEAP_MAPPED_QUEUE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "print_queue.h"
+#include "mapped_storage.h"
+
+
+
+// fixed-size record of a queued job in the mapped job table, indexed by job id
+struct MappedRecord {
+    // where the name is in the name region. for a free record, the id of the next free record + 1 (0 ends the list)
+    std::uint64_t nameOffset = 0;
+    std::uint32_t nameLength = 0;
+
+    // hash of the name, so the name index can grow without reading any names
+    std::uint32_t hash = 0;
+
+    int priority = 0;
+
+    // index of the job's key in the heap, or -1 for a free record
+    int position = -1;
+};
+
+static_assert(sizeof(MappedRecord) == 24, "mapped records are written to disk as they are");
+
+
+
+// slot of the name index: open addressing with linear probing, like NameIndex, only with ids instead of names,
+// so the table can live in a file
+struct MappedSlot {
+    std::uint32_t hash = 0;
+    std::uint32_t id = UINT32_MAX;   // UINT32_MAX marks an empty slot
+};
+
+
+
+// print queue kept entirely in memory-mapped files, for backlogs that are too big to rebuild on every start.
+// the heap keys, the job records and the name index are arrays of fixed-size records in one file each,
+// and the names go in a fourth file, <path>.names, as one region they are appended to. opening a queue maps
+// the files and nothing else: the heap is already a heap, and the OS pages in what the operations touch.
+//
+// checkpoints (checkpointJobs) sync all four files to disk and then mark them clean. the first change after
+// a checkpoint marks them dirty again, and syncs that mark. the job records are written so that each one on its
+// own always says whether its job is queued, so if the program dies while the queue is dirty, opening it
+// rebuilds the heap, the free list and the name index from the records in O(n). after a crash of the whole
+// machine, changes made since the last checkpoint may be partly lost; pair the queue with a JobLog if they must not be.
+//
+// offers the same operations as PrintQueue, see job_queue.h for picking one of them at compile time
+struct MappedQueue {
+    MappedHeap<HeapKey, HEAP_ARITY> heap;
+    MappedArray<MappedRecord> records;
+    MappedArray<MappedSlot> index;
+    MappedArray<char> names;
+
+    // true while the files are marked dirty, i.e. since the first change after opening or the last checkpoint
+    bool dirty = false;
+
+    MappedQueue() = default;
+
+    // open the queue at 'path', see openJobs. check isOpen() for the result
+    explicit MappedQueue(const std::string &path);
+
+    // checkpoint and close, see closeJobs
+    ~MappedQueue();
+
+    MappedQueue(const MappedQueue &) = delete;
+    MappedQueue &operator=(const MappedQueue &) = delete;
+
+    bool isOpen() const { return heap.isOpen(); }
+    bool empty() const { return heap.empty(); }
+    int size() const { return static_cast<int>(heap.size()); }
+};
+
+
+
+// name of the job a heap key belongs to. it points into the mapped name region,
+// so it is only valid until the queue is changed
+inline std::string_view jobName(const MappedQueue &jobs, const HeapKey &key) {
+    const MappedRecord &record = jobs.records[key.id];
+    return {jobs.names.data() + record.nameOffset, record.nameLength};
+}
+
+
+
+// open the queue kept in the files <path>.heap, <path>.jobs, <path>.index and <path>.names, creating them if there
+// are none. a queue that wasn't checkpointed before it was last closed is repaired from its job records.
+// returns false if the files can't be mapped, or aren't queue files
+bool openJobs(MappedQueue &jobs, const std::string &path);
+
+// sync every change so far to disk, and mark the files clean. returns false if syncing failed
+bool checkpointJobs(MappedQueue &jobs);
+
+// checkpoint and unmap the queue
+void closeJobs(MappedQueue &jobs);
+
+// add a job. returns false (and changes nothing) if a job with that name is already queued, or the files can't grow
+bool pushJob(MappedQueue &jobs, std::string_view name, int priority);
+
+// remove the job with the highest priority into 'job'. returns false if the queue is empty
+bool popJob(MappedQueue &jobs, PrintJob &job);
+
+// copy the job with the highest priority into 'job', without removing it. returns false if the queue is empty
+bool peekJob(const MappedQueue &jobs, PrintJob &job);
+
+// change the priority of a queued job. returns false if no job with that name is queued
+bool changePriority(MappedQueue &jobs, std::string_view name, int new_priority);
+
+// remove a queued job, wherever it is in the heap, in O(log n). returns false if no job with that name is queued
+bool removeJob(MappedQueue &jobs, std::string_view name);
+
+// make room for 'n' queued jobs in total, so adding that many jobs doesn't grow the files (apart from the names)
+void reserveJobs(MappedQueue &jobs, int n);
+
+// keys of the k jobs with the highest priority (or of all jobs, if there are fewer), highest first.
+// the heap is not touched, and the cost is O(k log k)
+std::vector<HeapKey> topK(const MappedQueue &jobs, int k);
+
+#endif // MAXHEAP_MAPPED_QUEUE_H
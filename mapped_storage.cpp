@@ -0,0 +1,152 @@
+#include "mapped_storage.h"
+
+#include <algorithm> // for std::max
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+
+// first bytes of every mapped file
+static constexpr char MAPPED_MAGIC[8] = {'M', 'H', 'M', 'A', 'P', 'P', 'E', 'D'};
+
+// version of the header layout above
+static constexpr std::uint32_t MAPPED_VERSION = 1;
+
+// smallest capacity a file grows to, in bytes of records
+static constexpr std::size_t MIN_GROWTH_BYTES = 4096;
+
+
+
+// offset of the first record, so that the record 'skewBytes' after it starts a cache line
+static std::size_t dataOffset(std::size_t skewBytes) {
+    std::size_t aligned = (sizeof(MappedFileHeader) + skewBytes + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    return aligned - skewBytes;
+}
+
+
+
+MappedRegion::~MappedRegion() {
+    close();
+}
+
+
+
+bool MappedRegion::open(const std::string &path, std::size_t recordSize, std::size_t skewBytes) {
+    close();
+
+    int file = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (file < 0)
+        return false;
+
+    struct stat info {};
+    if (::fstat(file, &info) != 0) {
+        ::close(file);
+        return false;
+    }
+
+    std::size_t offset = dataOffset(skewBytes);
+    auto fileBytes = static_cast<std::size_t>(info.st_size);
+    if (fileBytes == 0) {
+        // a new file: just the header, without any room for records yet
+        MappedFileHeader fresh{};
+        std::memcpy(fresh.magic, MAPPED_MAGIC, sizeof(MAPPED_MAGIC));
+        fresh.version = MAPPED_VERSION;
+        fresh.recordSize = static_cast<std::uint32_t>(recordSize);
+        fresh.dataOffset = offset;
+        if (::posix_fallocate(file, 0, static_cast<off_t>(offset)) != 0 ||
+            ::pwrite(file, &fresh, sizeof(fresh), 0) != static_cast<ssize_t>(sizeof(fresh))) {
+            ::close(file);
+            return false;
+        }
+        fileBytes = offset;
+    }
+
+    MappedFileHeader existing{};
+    bool ok = fileBytes >= offset &&
+              ::pread(file, &existing, sizeof(existing), 0) == static_cast<ssize_t>(sizeof(existing)) &&
+              std::memcmp(existing.magic, MAPPED_MAGIC, sizeof(MAPPED_MAGIC)) == 0 &&
+              existing.version == MAPPED_VERSION && existing.recordSize == recordSize &&
+              existing.dataOffset == offset && existing.count <= existing.capacity &&
+              existing.capacity <= (fileBytes - offset) / recordSize;
+    if (!ok) {
+        ::close(file);
+        return false;
+    }
+
+    std::size_t bytes = offset + existing.capacity * recordSize;
+    void *mapping = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    if (mapping == MAP_FAILED) {
+        ::close(file);
+        return false;
+    }
+
+    fd = file;
+    base = static_cast<char *>(mapping);
+    records = base + offset;
+    mappedBytes = bytes;
+    recordBytes = recordSize;
+    return true;
+}
+
+
+
+void MappedRegion::close() {
+    if (base == nullptr)
+        return;
+
+    ::munmap(base, mappedBytes);
+    ::close(fd);
+    fd = -1;
+    base = nullptr;
+    records = nullptr;
+    mappedBytes = 0;
+}
+
+
+
+bool MappedRegion::reserve(std::uint64_t n) {
+    if (base == nullptr)
+        return false;
+
+    std::uint64_t capacity = header()->capacity;
+    if (n <= capacity)
+        return true;
+
+    std::uint64_t grown = std::max({n, capacity * 2, static_cast<std::uint64_t>(MIN_GROWTH_BYTES / recordBytes + 1)});
+    std::size_t offset = static_cast<std::size_t>(records - base);
+    std::size_t bytes = offset + grown * recordBytes;
+
+    // the blocks are allocated up front, so a full disk shows up here and not as SIGBUS on some later write
+    if (::posix_fallocate(fd, 0, static_cast<off_t>(bytes)) != 0)
+        return false;
+
+#ifdef __linux__
+    void *mapping = ::mremap(base, mappedBytes, bytes, MREMAP_MAYMOVE);
+#else
+    void *mapping = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping != MAP_FAILED)
+        ::munmap(base, mappedBytes);
+#endif
+    if (mapping == MAP_FAILED)
+        return false;
+
+    base = static_cast<char *>(mapping);
+    records = base + offset;
+    mappedBytes = bytes;
+    header()->capacity = grown;
+    return true;
+}
+
+
+
+bool MappedRegion::sync() {
+    return base != nullptr && ::msync(base, mappedBytes, MS_SYNC) == 0;
+}
+
+
+
+bool MappedRegion::syncHeader() {
+    return base != nullptr && ::msync(base, sizeof(MappedFileHeader), MS_SYNC) == 0;
+}
@@ -0,0 +1,157 @@
+#ifndef MAXHEAP_MAPPED_STORAGE_H
+#define MAXHEAP_MAPPED_STORAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>     // for std::memcpy
+#include <string>
+#include <type_traits>
+
+#include "dary_heap.h"
+
+
+
+// header at the start of every mapped file. the records follow at 'dataOffset', in native byte order
+struct MappedFileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t recordSize;
+    std::uint64_t dataOffset;
+
+    // records in use, and records the file has room for
+    std::uint64_t count;
+    std::uint64_t capacity;
+
+    // free for the owner of the file, e.g. for a free list head or a flag
+    std::uint64_t meta[4];
+};
+
+
+
+// a file of fixed-size records, mapped into memory. the records are read and written in place, so the file is
+// always up to date as far as this process is concerned, and the OS writes changed pages back in its own time
+// (sync() forces that). when the file runs out of room it is extended and remapped at twice the capacity,
+// which can move the mapping, so like with a vector, pointers into it are only valid until the next growth.
+// the space for the new capacity is allocated on disk right away: writing to a page the file system can't
+// back would otherwise kill the process with SIGBUS, instead of failing the growth
+class MappedRegion {
+public:
+    MappedRegion() = default;
+    ~MappedRegion();
+
+    MappedRegion(const MappedRegion &) = delete;
+    MappedRegion &operator=(const MappedRegion &) = delete;
+
+    // open the file at 'path', or create an empty one. the first record is placed 'skewBytes' before a cache line
+    // boundary (see ChildGroupAllocator). returns false if the file can't be mapped, or was written with another
+    // record size or layout
+    bool open(const std::string &path, std::size_t recordSize, std::size_t skewBytes);
+
+    // unmap and close the file. changes are not synced, but they stay in the OS page cache like any file write
+    void close();
+
+    bool isOpen() const { return base != nullptr; }
+
+    char *data() const { return records; }
+    std::uint64_t size() const { return base ? header()->count : 0; }
+    std::uint64_t capacity() const { return base ? header()->capacity : 0; }
+
+    // set the number of records in use. callers reserve room first
+    void setSize(std::uint64_t n) { header()->count = n; }
+
+    // make room for 'n' records. returns false if the file can't grow, or isn't open
+    bool reserve(std::uint64_t n);
+
+    std::uint64_t &meta(int i) const { return header()->meta[i]; }
+
+    // wait until everything in the file is written back to disk
+    bool sync();
+
+    // the same, only for the header
+    bool syncHeader();
+
+private:
+    MappedFileHeader *header() const { return reinterpret_cast<MappedFileHeader *>(base); }
+
+    int fd = -1;
+    char *base = nullptr;
+    char *records = nullptr;
+    std::size_t mappedBytes = 0;
+    std::size_t recordBytes = 0;
+};
+
+
+
+// growable array of trivially copyable T, kept in a mapped file. it has the parts of the vector interface the
+// queue code uses, except that anything that grows the array returns false when the file can't grow
+template<typename T, std::size_t Skew = 0>
+class MappedArray {
+    static_assert(std::is_trivially_copyable_v<T>, "mapped records are stored as plain bytes");
+
+public:
+    using value_type = T;
+
+    bool open(const std::string &path) { return region.open(path, sizeof(T), Skew * sizeof(T)); }
+    void close() { region.close(); }
+    bool isOpen() const { return region.isOpen(); }
+
+    std::size_t size() const { return region.size(); }
+    bool empty() const { return size() == 0; }
+    std::size_t capacity() const { return region.capacity(); }
+
+    T *data() { return reinterpret_cast<T *>(region.data()); }
+    const T *data() const { return reinterpret_cast<const T *>(region.data()); }
+
+    T &operator[](std::size_t i) { return data()[i]; }
+    const T &operator[](std::size_t i) const { return data()[i]; }
+    T &front() { return data()[0]; }
+    const T &front() const { return data()[0]; }
+    T &back() { return data()[size() - 1]; }
+    const T &back() const { return data()[size() - 1]; }
+
+    bool reserve(std::size_t n) { return region.reserve(n); }
+
+    // grow or shrink to 'n' records. new records are value-initialized
+    bool resize(std::size_t n) {
+        if (!region.reserve(n))
+            return false;
+        for (std::size_t i = size(); i < n; i++)
+            data()[i] = T();
+        region.setSize(n);
+        return true;
+    }
+
+    // copy 'n' records to the end
+    bool append(const T *values, std::size_t n) {
+        if (!region.reserve(size() + n))
+            return false;
+        if (n > 0)
+            std::memcpy(data() + size(), values, n * sizeof(T));
+        region.setSize(size() + n);
+        return true;
+    }
+
+    bool push_back(const T &value) { return append(&value, 1); }
+    void pop_back() { region.setSize(size() - 1); }
+    void clear() { region.setSize(0); }
+
+    std::uint64_t &meta(int i) const { return region.meta(i); }
+
+    bool sync() { return region.sync(); }
+    bool syncHeader() { return region.syncHeader(); }
+
+private:
+    MappedRegion region;
+};
+
+
+
+// heap storage in a mapped file, aligned for the arity the same way as DaryHeap. it can be passed to
+// siftUp, popTop, buildHeap and the other heap routines in dary_heap.h
+template<typename T, int Arity = HEAP_ARITY>
+class MappedHeap : public MappedArray<T, Arity - 1> {
+public:
+    static constexpr int arity = Arity;
+};
+
+#endif // MAXHEAP_MAPPED_STORAGE_H
@@ -0,0 +1,178 @@
+#include "multi_queue.h"
+
+#include <algorithm>  // for std::max
+#include <functional> // for std::hash
+#include <random>
+#include <thread>
+
+
+
+// random numbers for picking sub-heaps. every thread has its own generator, so picking never synchronizes
+static std::uint32_t randomIndex(std::uint32_t bound) {
+    thread_local std::minstd_rand rng(static_cast<std::uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id())));
+    return static_cast<std::uint32_t>((static_cast<std::uint64_t>(rng()) * bound) >> 31);
+}
+
+
+
+MultiQueue::MultiQueue(int threads, int c, bool measureRankError) : measure(measureRankError) {
+    if (threads <= 0)
+        threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    if (c < 1)
+        c = 1;
+
+    // at least two sub-heaps, so a pop always has two to choose from
+    subCount = std::max(2, c * threads);
+    subs.reset(new SubQueue[subCount]);
+}
+
+
+
+MultiQueue::NameShard &MultiQueue::shardFor(std::string_view name) {
+    std::uint64_t hash = std::hash<std::string_view>{}(name);
+    return shards[(hash * 0x9E3779B97F4A7C15ull) >> (64 - SHARD_BITS)];
+}
+
+
+
+void MultiQueue::publishTop(SubQueue &sub) {
+    long long top = sub.queue.empty() ? EMPTY_TOP : sub.queue.heap.front().priority;
+    sub.top.store(top, std::memory_order_relaxed);
+}
+
+
+
+bool MultiQueue::insert(std::string_view name, int priority) {
+    NameShard &shard = shardFor(name);
+    std::lock_guard<std::mutex> shardGuard(shard.lock);
+    if (shard.ids.find(name) != NameIndex::NOT_FOUND)
+        return false;
+
+    // take the first random sub-heap that isn't busy
+    SubQueue *sub;
+    std::uint32_t index;
+    while (true) {
+        index = randomIndex(subCount);
+        sub = &subs[index];
+        if (sub->lock.try_lock())
+            break;
+    }
+
+    pushJob(sub->queue, name, priority);
+    publishTop(*sub);
+    sub->lock.unlock();
+
+    // remember which sub-heap the job went to
+    std::uint32_t id;
+    if (!shard.freeIds.empty()) {
+        id = shard.freeIds.back();
+        shard.freeIds.pop_back();
+    } else {
+        shard.entries.emplace_back();
+        id = static_cast<std::uint32_t>(shard.entries.size() - 1);
+    }
+    shard.entries[id].name = shard.names.intern(name);
+    shard.entries[id].subQueue = index;
+    shard.ids.insert(shard.entries[id].name.text, id);
+
+    count.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+
+
+void MultiQueue::popLocked(SubQueue &sub, PrintJob &job) {
+    popJob(sub.queue, job);
+    publishTop(sub);
+
+    if (measure) {
+        std::uint64_t error = 0;
+        for (int i = 0; i < subCount; i++) {
+            if (subs[i].top.load(std::memory_order_relaxed) > job.priority)
+                error++;
+        }
+
+        measuredPops.fetch_add(1, std::memory_order_relaxed);
+        rankErrorSum.fetch_add(error, std::memory_order_relaxed);
+        std::uint64_t worst = maxRankError.load(std::memory_order_relaxed);
+        while (error > worst && !maxRankError.compare_exchange_weak(worst, error, std::memory_order_relaxed)) {}
+    }
+}
+
+
+
+bool MultiQueue::tryPop(PrintJob &job) {
+    bool popped = false;
+
+    // a few rounds of "better of two random sub-heaps", skipping sub-heaps that are busy
+    for (int attempt = 0; attempt < 4 * subCount && !popped; attempt++) {
+        if (count.load(std::memory_order_relaxed) == 0)
+            return false;
+
+        SubQueue &a = subs[randomIndex(subCount)];
+        SubQueue &b = subs[randomIndex(subCount)];
+        SubQueue &best = a.top.load(std::memory_order_relaxed) >= b.top.load(std::memory_order_relaxed) ? a : b;
+        if (best.top.load(std::memory_order_relaxed) == EMPTY_TOP || !best.lock.try_lock())
+            continue;
+
+        // the top may have been taken since it was read
+        if (!best.queue.empty()) {
+            popLocked(best, job);
+            popped = true;
+        }
+        best.lock.unlock();
+    }
+
+    // the random picks kept missing: the queue is nearly empty or very busy, so walk all sub-heaps in turn
+    for (int i = 0; i < subCount && !popped; i++) {
+        std::lock_guard<std::mutex> guard(subs[i].lock);
+        if (!subs[i].queue.empty()) {
+            popLocked(subs[i], job);
+            popped = true;
+        }
+    }
+    if (!popped)
+        return false;
+
+    // the job is out of its sub-heap, now release its name
+    NameShard &shard = shardFor(job.name);
+    {
+        std::lock_guard<std::mutex> shardGuard(shard.lock);
+        std::uint32_t id = shard.ids.find(job.name);
+        shard.ids.erase(job.name);
+        shard.names.release(shard.entries[id].name);
+        shard.entries[id] = NameEntry();
+        shard.freeIds.push_back(id);
+    }
+    count.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+
+
+bool MultiQueue::update(std::string_view name, int new_priority) {
+    NameShard &shard = shardFor(name);
+    std::lock_guard<std::mutex> shardGuard(shard.lock);
+
+    std::uint32_t id = shard.ids.find(name);
+    if (id == NameIndex::NOT_FOUND)
+        return false;
+
+    // the job may have been popped already, with only its name still waiting to be released
+    SubQueue &sub = subs[shard.entries[id].subQueue];
+    std::lock_guard<std::mutex> subGuard(sub.lock);
+    if (!changePriority(sub.queue, name, new_priority))
+        return false;
+    publishTop(sub);
+    return true;
+}
+
+
+
+RelaxationStats MultiQueue::stats() const {
+    RelaxationStats stats;
+    stats.pops = measuredPops.load(std::memory_order_relaxed);
+    stats.rankErrorSum = rankErrorSum.load(std::memory_order_relaxed);
+    stats.maxRankError = maxRankError.load(std::memory_order_relaxed);
+    return stats;
+}
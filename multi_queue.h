@@ -0,0 +1,112 @@
+#ifndef MAXHEAP_MULTI_QUEUE_H
+#define MAXHEAP_MULTI_QUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "print_queue.h"
+
+
+
+// counters describing how far a relaxed queue strays from strict priority order
+struct RelaxationStats {
+    // number of pops that were measured
+    std::uint64_t pops = 0;
+
+    // sum and maximum of the rank error over those pops. the rank error of a pop is counted as the number
+    // of sub-heaps whose top job had a higher priority than the popped one at the time of the pop, which is
+    // a lower bound on how many queued jobs should have been printed first
+    std::uint64_t rankErrorSum = 0;
+    std::uint64_t maxRankError = 0;
+
+    double averageRankError() const { return pops ? static_cast<double>(rankErrorSum) / pops : 0.0; }
+};
+
+
+
+// relaxed print queue for many threads (a "MultiQueue"): c * threads independent heaps, each with its own lock.
+// an insert goes into a random sub-heap, and a pop looks at the tops of two random sub-heaps and takes the better one.
+// so a pop returns one of the best few jobs rather than always the best one, but threads almost never wait
+// for each other, since there are always more sub-heaps than threads.
+//
+// job names are registered in sharded name tables, so names stay unique across all sub-heaps,
+// and update() can find the sub-heap a job is in. locks are taken name shard first, then sub-heap
+class MultiQueue {
+public:
+    // 'threads' is the number of threads expected to use the queue, and 'c' the number of sub-heaps per thread.
+    // with 'measureRankError', every pop also compares its job against all sub-heap tops (see RelaxationStats)
+    explicit MultiQueue(int threads = 0, int c = 2, bool measureRankError = false);
+
+    // add a job to a random sub-heap. returns false if a job with that name is queued
+    bool insert(std::string_view name, int priority);
+
+    // remove a job with (nearly) the highest priority into 'job'. returns false if the queue is empty
+    bool tryPop(PrintJob &job);
+
+    // change the priority of a queued job. returns false if no job with that name is queued
+    bool update(std::string_view name, int new_priority);
+
+    // number of queued jobs
+    int size() const { return count.load(std::memory_order_relaxed); }
+
+    int subQueueCount() const { return subCount; }
+
+    // snapshot of the rank error counters. all zero unless the queue measures rank errors
+    RelaxationStats stats() const;
+
+private:
+    // value of 'top' for an empty sub-heap
+    static constexpr long long EMPTY_TOP = INT64_MIN;
+
+    static constexpr int SHARD_BITS = 4;
+    static constexpr int SHARD_COUNT = 1 << SHARD_BITS;
+
+    struct alignas(CACHE_LINE_SIZE) SubQueue {
+        std::mutex lock;
+        PrintQueue queue;
+
+        // priority of the top job, readable without the lock. only a hint for choosing where to pop
+        std::atomic<long long> top{EMPTY_TOP};
+    };
+
+    // a registered name, and the sub-heap its job is in
+    struct NameEntry {
+        NameRef name;
+        std::uint32_t subQueue = 0;
+    };
+
+    // maps each name to the sub-heap its job is in
+    struct alignas(CACHE_LINE_SIZE) NameShard {
+        std::mutex lock;
+        NameArena names;
+
+        // name -> index in 'entries'
+        NameIndex ids;
+        std::vector<NameEntry> entries;
+        std::vector<std::uint32_t> freeIds;
+    };
+
+    NameShard &shardFor(std::string_view name);
+
+    // republish the top priority of a sub-heap after it changed. its lock must be held
+    static void publishTop(SubQueue &sub);
+
+    // pop from a sub-heap that is locked and not empty, and count the rank error if enabled
+    void popLocked(SubQueue &sub, PrintJob &job);
+
+    std::unique_ptr<SubQueue[]> subs;
+    int subCount;
+    NameShard shards[SHARD_COUNT];
+    std::atomic<int> count{0};
+
+    bool measure;
+    std::atomic<std::uint64_t> measuredPops{0};
+    std::atomic<std::uint64_t> rankErrorSum{0};
+    std::atomic<std::uint64_t> maxRankError{0};
+};
+
+#endif // MAXHEAP_MULTI_QUEUE_H
@@ -0,0 +1,82 @@
+#include "name_arena.h"
+
+#include <cstring> // for std::memcpy
+
+
+
+std::uint32_t NameArena::startChunk(std::size_t bytes) {
+    // ordinary names go into a spare chunk if there is one, so the allocator isn't touched at all
+    if (bytes <= CHUNK_SIZE && !spareChunks.empty()) {
+        std::uint32_t index = spareChunks.back();
+        spareChunks.pop_back();
+        return index;
+    }
+
+    std::uint32_t index;
+    if (!freeSlots.empty()) {
+        index = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        chunks.emplace_back();
+        index = static_cast<std::uint32_t>(chunks.size() - 1);
+    }
+
+    Chunk &chunk = chunks[index];
+    chunk.capacity = bytes <= CHUNK_SIZE ? CHUNK_SIZE : bytes;
+    chunk.data.reset(new char[chunk.capacity]);
+    chunk.used = 0;
+    chunk.live = 0;
+    reserved += chunk.capacity;
+    return index;
+}
+
+
+
+void NameArena::retireChunk(std::uint32_t index) {
+    Chunk &chunk = chunks[index];
+    chunk.used = 0;
+
+    if (chunk.capacity == CHUNK_SIZE && spareChunks.size() < MAX_SPARE_CHUNKS) {
+        spareChunks.push_back(index);
+    } else {
+        reserved -= chunk.capacity;
+        chunk.data.reset();
+        chunk.capacity = 0;
+        freeSlots.push_back(index);
+    }
+}
+
+
+
+NameRef NameArena::intern(std::string_view name) {
+    // start a new chunk if the name doesn't fit in the current one
+    if (!hasCurrent || chunks[current].capacity - chunks[current].used < name.size()) {
+        // a current chunk without names would never be released by anyone, so retire it here
+        if (hasCurrent && chunks[current].live == 0)
+            retireChunk(current);
+        current = startChunk(name.size());
+        hasCurrent = true;
+    }
+
+    Chunk &chunk = chunks[current];
+    char *text = chunk.data.get() + chunk.used;
+    if (!name.empty())
+        std::memcpy(text, name.data(), name.size());
+    chunk.used += name.size();
+    chunk.live++;
+    return {std::string_view(text, name.size()), current};
+}
+
+
+
+void NameArena::release(const NameRef &name) {
+    Chunk &chunk = chunks[name.chunk];
+    if (--chunk.live > 0)
+        return;
+
+    // the last name in this chunk is gone, so all of its space can be reused at once.
+    // the current chunk just starts over from the beginning
+    chunk.used = 0;
+    if (name.chunk != current)
+        retireChunk(name.chunk);
+}
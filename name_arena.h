@@ -0,0 +1,70 @@
+#ifndef MAXHEAP_NAME_ARENA_H
+#define MAXHEAP_NAME_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+
+
+// a job name stored in the arena, plus the chunk it lives in so it can be released again
+struct NameRef {
+    std::string_view text;
+    std::uint32_t chunk = 0;
+};
+
+
+
+// arena that stores every job name exactly once, in large chunks instead of one allocation per name.
+// every chunk counts how many of its names are still in use. once that count drops to zero the
+// whole chunk is reclaimed at once: the chunk being filled is simply rewound, other chunks are kept
+// as spares for later (up to a small limit) or given back to the allocator
+class NameArena {
+public:
+    // bytes per chunk. names longer than this get a chunk of their own
+    static constexpr std::size_t CHUNK_SIZE = 64 * 1024;
+
+    // number of empty chunks kept around instead of being freed
+    static constexpr std::size_t MAX_SPARE_CHUNKS = 4;
+
+    // copy a name into the arena
+    NameRef intern(std::string_view name);
+
+    // mark a name as no longer used. its chunk is reclaimed once none of its names are used
+    void release(const NameRef &name);
+
+    // bytes currently allocated for chunks, used or not
+    std::size_t reservedBytes() const { return reserved; }
+
+private:
+    struct Chunk {
+        std::unique_ptr<char[]> data;
+        std::size_t capacity = 0;
+        std::size_t used = 0;
+        std::size_t live = 0;
+    };
+
+    // get a chunk with room for at least 'bytes', and return its index
+    std::uint32_t startChunk(std::size_t bytes);
+
+    // put an empty chunk that isn't the current one aside as a spare, or free its storage
+    void retireChunk(std::uint32_t index);
+
+    std::vector<Chunk> chunks;
+
+    // empty chunks that still have their storage
+    std::vector<std::uint32_t> spareChunks;
+
+    // entries of 'chunks' whose storage was freed
+    std::vector<std::uint32_t> freeSlots;
+
+    // chunk new names are appended to
+    std::uint32_t current = 0;
+    bool hasCurrent = false;
+
+    std::size_t reserved = 0;
+};
+
+#endif // MAXHEAP_NAME_ARENA_H
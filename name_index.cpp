@@ -0,0 +1,129 @@
+#include "name_index.h"
+
+#include <algorithm>  // for std::fill
+#include <functional> // for std::hash
+
+#include "op_stats.h"
+
+
+
+std::uint32_t NameIndex::hashName(std::string_view name) {
+    std::size_t hash = std::hash<std::string_view>{}(name);
+    return static_cast<std::uint32_t>(hash ^ (hash >> 32));
+}
+
+
+
+std::size_t NameIndex::probe(std::string_view name, std::uint32_t hash) const {
+    std::size_t mask = slots.size() - 1;
+    std::size_t i = hash & mask;
+
+    // walk forward until the name or an empty slot turns up. the stored hash is compared first,
+    // so names are only compared when they are very likely equal
+    std::size_t home = i;
+    while (slots[i].id != NOT_FOUND) {
+        if (slots[i].hash == hash && slots[i].name == name)
+            break;
+        i = (i + 1) & mask;
+    }
+
+    // the slots looked at are the run from the home slot up to here, so the loop itself counts nothing
+    if (opStats.enabled)
+        workCounters.probes += ((i - home) & mask) + 1;
+    return i;
+}
+
+
+
+std::uint32_t NameIndex::find(std::string_view name) const {
+    if (count == 0)
+        return NOT_FOUND;
+    return slots[probe(name, hashName(name))].id;
+}
+
+
+
+void NameIndex::insert(std::string_view name, std::uint32_t id) {
+    // keep the table at most 3/4 full so probe sequences stay short
+    if ((count + 1) * 4 > slots.size() * 3)
+        rehash(slots.empty() ? 16 : slots.size() * 2);
+
+    std::uint32_t hash = hashName(name);
+    Slot &slot = slots[probe(name, hash)];
+    slot.name = name;
+    slot.hash = hash;
+    slot.id = id;
+    count++;
+}
+
+
+
+void NameIndex::prefetch(std::string_view name) const {
+    if (!slots.empty())
+        __builtin_prefetch(&slots[hashName(name) & (slots.size() - 1)]);
+}
+
+
+
+bool NameIndex::erase(std::string_view name) {
+    if (count == 0)
+        return false;
+
+    std::size_t mask = slots.size() - 1;
+    std::size_t hole = probe(name, hashName(name));
+    if (slots[hole].id == NOT_FOUND)
+        return false;
+
+    // backward shift deletion: move later entries of the probe run into the hole when their
+    // home slot allows it, so no tombstones are needed and lookups never slow down over time
+    std::size_t i = hole;
+    while (true) {
+        i = (i + 1) & mask;
+        if (slots[i].id == NOT_FOUND)
+            break;
+
+        // distance of slot i from its home slot, and from the hole
+        std::size_t home = slots[i].hash & mask;
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            slots[hole] = slots[i];
+            hole = i;
+        }
+    }
+    slots[hole] = Slot();
+    count--;
+    return true;
+}
+
+
+
+void NameIndex::clear() {
+    std::fill(slots.begin(), slots.end(), Slot());
+    count = 0;
+}
+
+
+
+void NameIndex::reserve(std::size_t n) {
+    std::size_t capacity = 16;
+    while (capacity * 3 < n * 4)
+        capacity *= 2;
+    if (capacity > slots.size())
+        rehash(capacity);
+}
+
+
+
+void NameIndex::rehash(std::size_t capacity) {
+    std::vector<Slot> old = std::move(slots);
+    slots.assign(capacity, Slot());
+
+    std::size_t mask = capacity - 1;
+    for (const auto &slot : old) {
+        if (slot.id == NOT_FOUND)
+            continue;
+        std::size_t i = slot.hash & mask;
+        while (slots[i].id != NOT_FOUND)
+            i = (i + 1) & mask;
+        slots[i] = slot;
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef MAXHEAP_NAME_INDEX_H
+#define MAXHEAP_NAME_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+
+
+// hash table from job name to job id, used both to look jobs up by name and to reject duplicate names.
+// it uses open addressing with linear probing in one flat array, so inserting and erasing never
+// allocate (apart from the occasional growth), and the names are only referenced, never copied:
+// they have to stay valid for as long as they are in the index (the job names live in a NameArena)
+class NameIndex {
+public:
+    // value returned by find() for names that aren't in the index
+    static constexpr std::uint32_t NOT_FOUND = UINT32_MAX;
+
+    // id stored for 'name', or NOT_FOUND
+    std::uint32_t find(std::string_view name) const;
+
+    // add a name that is not in the index yet
+    void insert(std::string_view name, std::uint32_t id);
+
+    // remove a name. returns false if it wasn't in the index
+    bool erase(std::string_view name);
+
+    std::size_t size() const { return count; }
+
+    // number of slots in the table, which is what clear() has to walk
+    std::size_t capacity() const { return slots.size(); }
+
+    // remove every name at once, keeping the table's storage
+    void clear();
+
+    // start loading the slot where 'name' would be looked up, for callers inserting or finding many names in a row.
+    // the table is one big array, so every lookup is a cache miss once it outgrows the cache
+    void prefetch(std::string_view name) const;
+
+    // make room for 'n' names without growing again
+    void reserve(std::size_t n);
+
+private:
+    struct Slot {
+        std::string_view name;
+        std::uint32_t hash = 0;
+        std::uint32_t id = NOT_FOUND;   // NOT_FOUND marks an empty slot
+    };
+
+    static std::uint32_t hashName(std::string_view name);
+
+    // index of the slot holding 'name', or the empty slot where it would go
+    std::size_t probe(std::string_view name, std::uint32_t hash) const;
+
+    // rehash everything into a table with 'capacity' slots (a power of two)
+    void rehash(std::size_t capacity);
+
+    std::vector<Slot> slots;
+    std::size_t count = 0;
+};
+
+#endif // MAXHEAP_NAME_INDEX_H
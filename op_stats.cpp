@@ -0,0 +1,111 @@
+#include "op_stats.h"
+
+#include <algorithm> // for std::fill, std::min
+#include <cmath>     // for std::ceil
+
+#include "output_sink.h"
+
+
+
+std::uint64_t LatencyHistogram::bucketTop(int b) {
+    if (b < SUB_BUCKETS)
+        return static_cast<std::uint64_t>(b);
+    int top = b / SUB_BUCKETS + SUB_BITS - 1;
+    std::uint64_t next = static_cast<std::uint64_t>(SUB_BUCKETS + b % SUB_BUCKETS + 1) << (top - SUB_BITS);
+    // for the very last bucket this wraps around to the largest 64-bit value, which is what it should be
+    return next - 1;
+}
+
+
+
+std::uint64_t LatencyHistogram::percentile(double q) const {
+    if (total == 0)
+        return 0;
+
+    std::uint64_t rank = static_cast<std::uint64_t>(std::ceil(q * static_cast<double>(total)));
+    if (rank < 1)
+        rank = 1;
+
+    std::uint64_t seen = 0;
+    for (int b = 0; b < BUCKETS; b++) {
+        seen += counts[b];
+        if (seen >= rank)
+            return std::min(bucketTop(b), largest);
+    }
+    return largest;
+}
+
+
+
+void LatencyHistogram::clear() {
+    std::fill(counts.begin(), counts.end(), 0);
+    total = 0;
+    largest = 0;
+}
+
+
+
+void resetOpStats() {
+    for (auto &stats : opStats.ops) {
+        stats.latency.clear();
+        stats.work = WorkCounters();
+    }
+}
+
+
+
+// helper for writing total / calls with one decimal, without going through floating point formatting
+static void writeAverage(OutputSink &out, std::uint64_t total, std::uint64_t calls) {
+    std::uint64_t tenths = (total * 10 + calls / 2) / calls;
+    out << tenths / 10 << '.' << static_cast<char>('0' + tenths % 10);
+}
+
+
+
+// only PrintQueue counts comparisons, moves and sift levels. the other backends have heaps of their own
+#if MAXHEAP_PAIRING_HEAP || MAXHEAP_BUCKET_QUEUE || MAXHEAP_BOUNDED_QUEUE || MAXHEAP_AGING_QUEUE || MAXHEAP_MAPPED_QUEUE
+static constexpr bool HEAP_WORK_COUNTED = false;
+#else
+static constexpr bool HEAP_WORK_COUNTED = true;
+#endif
+
+
+
+void dumpOpStats(OutputSink &out) {
+    static const char *const names[STAT_OPS] = {
+        "heapify", "heapifyInsertOperation", "insertNode", "processHighestPriorityJob", "updateJobPriority",
+        "cancelPrintJob",
+    };
+
+    if (!opStats.enabled) {
+        out << "Operation statistics are off.\n";
+        return;
+    }
+
+    bool any = false;
+    for (int op = 0; op < STAT_OPS; op++) {
+        const OpStats &stats = opStats.ops[op];
+        std::uint64_t calls = stats.latency.count();
+        if (calls == 0)
+            continue;
+        any = true;
+
+        out << names[op] << ": " << calls << " calls, p50 " << stats.latency.percentile(0.5)
+            << " ns, p99 " << stats.latency.percentile(0.99) << " ns, p99.9 " << stats.latency.percentile(0.999)
+            << " ns, max " << stats.latency.max() << " ns\n    per call: ";
+        if (HEAP_WORK_COUNTED) {
+            writeAverage(out, stats.work.comparisons, calls);
+            out << " comparisons, ";
+            writeAverage(out, stats.work.moves, calls);
+            out << " moves, ";
+            writeAverage(out, stats.work.levels, calls);
+            out << " sift levels, ";
+        }
+        writeAverage(out, stats.work.probes, calls);
+        out << " index probes\n";
+    }
+    if (!any)
+        out << "No operations recorded yet.\n";
+    else if (!HEAP_WORK_COUNTED)
+        out << "This queue backend doesn't count comparisons, moves or sift levels, only the d-ary heap does.\n";
+}
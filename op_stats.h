@@ -0,0 +1,149 @@
+#ifndef MAXHEAP_OP_STATS_H
+#define MAXHEAP_OP_STATS_H
+
+#include <array>
+#include <bit>       // for std::bit_width
+#include <chrono>
+#include <cstdint>
+
+class OutputSink;
+
+
+
+// work done on the calling thread so far, counted where it happens: comparisons between heap keys, keys moved
+// inside the heap, levels a sifted key travelled, and slots looked at in the name index.
+// every thread has its own, so counting is a plain increment that is never shared with another core. work is only
+// counted on threads that keep statistics (see enableOpStats), the others run the same code as without counters.
+// only the d-ary heap (PrintQueue) and the name index count their work, the other backends don't
+struct WorkCounters {
+    std::uint64_t comparisons = 0;
+    std::uint64_t moves = 0;
+    std::uint64_t levels = 0;
+    std::uint64_t probes = 0;
+};
+
+inline thread_local WorkCounters workCounters;
+
+
+
+// latency histogram in the style of HdrHistogram: values are grouped by their highest set bit, and every power of
+// two is split into SUB_BUCKETS equal steps. values below SUB_BUCKETS are exact, any larger one is kept to within
+// 1/SUB_BUCKETS (about 3%), all the way up to 2^64 ns, in a fixed 15 KiB. recording is a few bit operations
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BITS = 5;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BITS;
+    static constexpr int BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+    void record(std::uint64_t nanos) {
+        counts[bucketOf(nanos)]++;
+        total++;
+        if (nanos > largest)
+            largest = nanos;
+    }
+
+    std::uint64_t count() const { return total; }
+    std::uint64_t max() const { return largest; }
+
+    // value below which a share 'q' (0-1) of the recorded values lie. it is the top of the bucket that value
+    // fell in, so it is never less than the real one. 0 if nothing was recorded
+    std::uint64_t percentile(double q) const;
+
+    void clear();
+
+private:
+    static int bucketOf(std::uint64_t value) {
+        if (value < SUB_BUCKETS)
+            return static_cast<int>(value);
+        int top = std::bit_width(value) - 1;
+        int sub = static_cast<int>(value >> (top - SUB_BITS)) & (SUB_BUCKETS - 1);
+        return (top - SUB_BITS + 1) * SUB_BUCKETS + sub;
+    }
+
+    // largest value that falls in bucket b
+    static std::uint64_t bucketTop(int b);
+
+    std::array<std::uint64_t, BUCKETS> counts{};
+    std::uint64_t total = 0;
+    std::uint64_t largest = 0;
+};
+
+
+
+// operations that keep statistics
+enum class StatOp {
+    Heapify,
+    HeapifyInsert,
+    InsertNode,
+    ProcessJob,
+    UpdatePriority,
+    CancelJob,
+};
+
+constexpr int STAT_OPS = 6;
+
+
+
+// everything recorded about one operation: how long every call took, and the work all calls did together
+struct OpStats {
+    LatencyHistogram latency;
+    WorkCounters work;
+};
+
+
+
+// statistics of the calling thread. they are only kept once enableOpStats(true) was called on the thread,
+// until then timing an operation costs a single check
+struct OpStatsTable {
+    bool enabled = false;
+    OpStats ops[STAT_OPS];
+};
+
+inline thread_local OpStatsTable opStats;
+
+// turn statistics on or off for the calling thread
+inline void enableOpStats(bool on) { opStats.enabled = on; }
+
+// forget everything recorded on the calling thread so far
+void resetOpStats();
+
+// write the calling thread's statistics, one line per operation that was called: number of calls,
+// p50/p99/p99.9/max latency, and the comparisons, moves, sift levels and name index probes per call
+void dumpOpStats(OutputSink &out);
+
+
+
+// times one operation, from construction to destruction, and charges the time and the work counted meanwhile
+// to 'op' in the calling thread's statistics. nested operations are also charged to the operations around them
+class OpTimer {
+public:
+    explicit OpTimer(StatOp op) : op(op), active(opStats.enabled) {
+        if (active) {
+            before = workCounters;
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~OpTimer() {
+        if (!active)
+            return;
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        OpStats &stats = opStats.ops[static_cast<int>(op)];
+        stats.latency.record(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        stats.work.comparisons += workCounters.comparisons - before.comparisons;
+        stats.work.moves += workCounters.moves - before.moves;
+        stats.work.levels += workCounters.levels - before.levels;
+        stats.work.probes += workCounters.probes - before.probes;
+    }
+
+    OpTimer(const OpTimer &) = delete;
+    OpTimer &operator=(const OpTimer &) = delete;
+
+private:
+    StatOp op;
+    bool active;
+    WorkCounters before;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif // MAXHEAP_OP_STATS_H
@@ -0,0 +1,33 @@
+#include "output_sink.h"
+
+#include <cerrno>
+
+
+
+void OutputSink::append(const char *data, std::size_t size) {
+    if (!held && buffer.size() + size > BUFFER_SIZE)
+        flush();
+    buffer.insert(buffer.end(), data, data + size);
+}
+
+
+
+bool OutputSink::flush() {
+    const char *data = buffer.data();
+    std::size_t size = buffer.size();
+    bool ok = true;
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        writes++;
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            ok = false;
+            break;
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    buffer.clear();
+    return ok;
+}
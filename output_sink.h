@@ -0,0 +1,79 @@
+#ifndef MAXHEAP_OUTPUT_SINK_H
+#define MAXHEAP_OUTPUT_SINK_H
+
+#include <charconv>  // for std::to_chars
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+
+
+
+// buffered output for the program's messages. text is collected in one large buffer that is reused for the whole
+// run, numbers are formatted straight into it with std::to_chars, and the buffer is only written out when it is
+// full or when flush() is called, so a listing of any length costs a handful of write calls instead of one per line.
+// the interactive program flushes before it waits for input, which is also where every command ends.
+// in quiet mode everything written is dropped before any formatting is done
+class OutputSink {
+public:
+    static constexpr std::size_t BUFFER_SIZE = 64 * 1024;
+
+    explicit OutputSink(int fd = STDOUT_FILENO) : fd(fd) { buffer.reserve(BUFFER_SIZE); }
+    ~OutputSink() { flush(); }
+
+    OutputSink(const OutputSink &) = delete;
+    OutputSink &operator=(const OutputSink &) = delete;
+
+    void setQuiet(bool quiet) { silent = quiet; }
+    bool quiet() const { return silent; }
+
+    // while held, a full buffer grows instead of being written out, and only flush() writes it. the batch mode
+    // holds its output until the job log records of the commands that printed it are on disk
+    void hold(bool on) { held = on; }
+
+    OutputSink &operator<<(std::string_view text) {
+        if (!silent)
+            append(text.data(), text.size());
+        return *this;
+    }
+
+    OutputSink &operator<<(char c) {
+        if (!silent)
+            append(&c, 1);
+        return *this;
+    }
+
+    template<std::integral Number>
+    OutputSink &operator<<(Number number) {
+        if (silent)
+            return *this;
+
+        // enough for any 64-bit number with its sign
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), number);
+        append(digits, static_cast<std::size_t>(result.ptr - digits));
+        return *this;
+    }
+
+    // write out everything buffered so far. returns false if writing failed, the output is dropped then
+    bool flush();
+
+    // bytes written to the sink that haven't been written out yet
+    std::size_t buffered() const { return buffer.size(); }
+
+    // number of write calls made so far
+    std::uint64_t writeCount() const { return writes; }
+
+private:
+    void append(const char *data, std::size_t size);
+
+    int fd;
+    std::vector<char> buffer;
+    bool silent = false;
+    bool held = false;
+    std::uint64_t writes = 0;
+};
+
+#endif // MAXHEAP_OUTPUT_SINK_H
@@ -0,0 +1,233 @@
+#include "pairing_queue.h"
+
+#include <algorithm> // for std::min, std::max, std::push_heap, std::pop_heap
+
+
+
+// helper for handing out a node for a new job, reusing the node of a finished job if there is one
+static JobId allocateNode(PairingQueue &jobs) {
+    if (!jobs.freeIds.empty()) {
+        JobId id = jobs.freeIds.back();
+        jobs.freeIds.pop_back();
+        return id;
+    }
+    jobs.nodes.emplace_back();
+    return static_cast<JobId>(jobs.nodes.size() - 1);
+}
+
+
+
+// join two trees whose roots have no parent and no siblings. the root with the lower priority becomes
+// the leftmost child of the other one. returns the root of the joined tree
+static JobId meld(PairingQueue &jobs, JobId a, JobId b) {
+    if (a == PairingQueue::NONE)
+        return b;
+    if (b == PairingQueue::NONE)
+        return a;
+
+    // on equal priorities the tree that was already there stays on top
+    if (jobs.nodes[b].priority > jobs.nodes[a].priority)
+        std::swap(a, b);
+
+    PairingNode &parent = jobs.nodes[a];
+    PairingNode &child = jobs.nodes[b];
+    child.prev = a;
+    child.sibling = parent.child;
+    if (parent.child != PairingQueue::NONE)
+        jobs.nodes[parent.child].prev = b;
+    parent.child = b;
+    return a;
+}
+
+
+
+// detach the subtree rooted at a node that isn't the root from its parent and siblings
+static void cut(PairingQueue &jobs, JobId id) {
+    PairingNode &node = jobs.nodes[id];
+    PairingNode &prev = jobs.nodes[node.prev];
+
+    // 'prev' is either the parent, if this is its leftmost child, or the sibling to the left
+    if (prev.child == id)
+        prev.child = node.sibling;
+    else
+        prev.sibling = node.sibling;
+    if (node.sibling != PairingQueue::NONE)
+        jobs.nodes[node.sibling].prev = node.prev;
+
+    node.prev = PairingQueue::NONE;
+    node.sibling = PairingQueue::NONE;
+}
+
+
+
+// merge a list of siblings into one tree and return its root. first the siblings are melded in pairs from
+// left to right, then the pairs are melded into one tree from right to left. the two passes are what keeps
+// the tree shallow enough for the O(log n) amortized bound
+static JobId mergePairs(PairingQueue &jobs, JobId first) {
+    std::vector<JobId> &roots = jobs.mergeRoots;
+    roots.clear();
+
+    while (first != PairingQueue::NONE) {
+        JobId a = first;
+        JobId b = jobs.nodes[a].sibling;
+        first = b != PairingQueue::NONE ? jobs.nodes[b].sibling : PairingQueue::NONE;
+
+        jobs.nodes[a].prev = PairingQueue::NONE;
+        jobs.nodes[a].sibling = PairingQueue::NONE;
+        if (b != PairingQueue::NONE) {
+            jobs.nodes[b].prev = PairingQueue::NONE;
+            jobs.nodes[b].sibling = PairingQueue::NONE;
+        }
+        roots.push_back(meld(jobs, a, b));
+    }
+
+    JobId merged = PairingQueue::NONE;
+    for (auto it = roots.rbegin(); it != roots.rend(); ++it)
+        merged = meld(jobs, *it, merged);
+    return merged;
+}
+
+
+
+bool pushJob(PairingQueue &jobs, std::string_view name, int priority) {
+    if (jobs.jobIds.find(name) != NameIndex::NOT_FOUND)
+        return false;
+
+    JobId id = allocateNode(jobs);
+    PairingNode &node = jobs.nodes[id];
+    node = PairingNode();
+    node.priority = priority;
+    node.name = jobs.names.intern(name);
+    jobs.jobIds.insert(node.name.text, id);
+
+    // the new job is a tree of its own, melded with the root in O(1)
+    jobs.root = meld(jobs, jobs.root, id);
+    jobs.count++;
+    return true;
+}
+
+
+
+bool popJob(PairingQueue &jobs, PrintJob &job) {
+    if (jobs.empty())
+        return false;
+
+    JobId top = jobs.root;
+    PairingNode &node = jobs.nodes[top];
+    job.name.assign(node.name.text);
+    job.priority = node.priority;
+
+    // the root's children become the new tree
+    jobs.root = mergePairs(jobs, node.child);
+
+    jobs.jobIds.erase(node.name.text);
+    jobs.names.release(node.name);
+    node.name = NameRef();
+    node.child = PairingQueue::NONE;
+    jobs.freeIds.push_back(top);
+    jobs.count--;
+    return true;
+}
+
+
+
+bool peekJob(const PairingQueue &jobs, PrintJob &job) {
+    if (jobs.empty())
+        return false;
+
+    const PairingNode &node = jobs.nodes[jobs.root];
+    job.name.assign(node.name.text);
+    job.priority = node.priority;
+    return true;
+}
+
+
+
+bool changePriority(PairingQueue &jobs, std::string_view name, int new_priority) {
+    JobId id = jobs.jobIds.find(name);
+    if (id == NameIndex::NOT_FOUND)
+        return false;
+
+    PairingNode &node = jobs.nodes[id];
+    int old_priority = node.priority;
+    node.priority = new_priority;
+    if (id == jobs.root && new_priority >= old_priority)
+        return true;
+
+    if (new_priority >= old_priority) {
+        // the subtree stays heap-ordered below a raised node, so it moves to the root as a whole
+        cut(jobs, id);
+        jobs.root = meld(jobs, jobs.root, id);
+        return true;
+    }
+
+    // a lowered node may now be below its children: take it out on its own, and put its children back as one tree
+    if (id == jobs.root) {
+        jobs.root = mergePairs(jobs, node.child);
+    } else {
+        cut(jobs, id);
+        jobs.root = meld(jobs, jobs.root, mergePairs(jobs, node.child));
+    }
+    node.child = PairingQueue::NONE;
+    jobs.root = meld(jobs, jobs.root, id);
+    return true;
+}
+
+
+
+bool removeJob(PairingQueue &jobs, std::string_view name) {
+    JobId id = jobs.jobIds.find(name);
+    if (id == NameIndex::NOT_FOUND)
+        return false;
+
+    PairingNode &node = jobs.nodes[id];
+    if (id == jobs.root) {
+        jobs.root = mergePairs(jobs, node.child);
+    } else {
+        cut(jobs, id);
+        jobs.root = meld(jobs, jobs.root, mergePairs(jobs, node.child));
+    }
+
+    jobs.jobIds.erase(node.name.text);
+    jobs.names.release(node.name);
+    node.name = NameRef();
+    node.child = PairingQueue::NONE;
+    jobs.freeIds.push_back(id);
+    jobs.count--;
+    return true;
+}
+
+
+
+void reserveJobs(PairingQueue &jobs, int n) {
+    jobs.nodes.reserve(n);
+    jobs.jobIds.reserve(n);
+}
+
+
+
+std::vector<HeapKey> topK(const PairingQueue &jobs, int k) {
+    std::vector<HeapKey> keys;
+    k = std::min(std::max(k, 0), jobs.size());
+    keys.reserve(k);
+    if (k == 0)
+        return keys;
+
+    // best-first walk: the next best job is always in the frontier, which holds the children of every job taken so far
+    auto lower = [](const HeapKey &a, const HeapKey &b) { return higherKey(b, a); };
+    std::vector<HeapKey> frontier;
+    frontier.push_back({jobs.nodes[jobs.root].priority, jobs.root});
+
+    while (static_cast<int>(keys.size()) < k) {
+        std::pop_heap(frontier.begin(), frontier.end(), lower);
+        HeapKey best = frontier.back();
+        frontier.pop_back();
+        keys.push_back(best);
+
+        for (JobId child = jobs.nodes[best.id].child; child != PairingQueue::NONE; child = jobs.nodes[child].sibling) {
+            frontier.push_back({jobs.nodes[child].priority, child});
+            std::push_heap(frontier.begin(), frontier.end(), lower);
+        }
+    }
+    return keys;
+}
@@ -0,0 +1,92 @@
+#ifndef MAXHEAP_PAIRING_QUEUE_H
+#define MAXHEAP_PAIRING_QUEUE_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "print_queue.h"
+
+
+
+// one job in the pairing heap. nodes live in a pool and are linked by index, so a node's index is a stable
+// handle for its job: it never moves while the job is queued, no matter how the tree is restructured
+struct PairingNode {
+    int priority = 0;
+
+    // leftmost child, and the next sibling to the right
+    JobId child = UINT32_MAX;
+    JobId sibling = UINT32_MAX;
+
+    // parent if this is the leftmost child, otherwise the sibling to the left. UINT32_MAX (PairingQueue::NONE) for the root
+    JobId prev = UINT32_MAX;
+
+    NameRef name;
+};
+
+
+
+// the print queue as a pairing heap: a tree where every node has a priority at least as high as its children,
+// with no shape to maintain. insert is a single meld with the root, and raising a priority cuts the node's
+// subtree out and melds it with the root, both O(1). the cleanup is deferred to popJob, which merges the
+// root's children in two passes (O(log n) amortized).
+//
+// offers the same operations as PrintQueue, see job_queue.h for picking one of them at compile time
+struct PairingQueue {
+    // index used for "no node"
+    static constexpr JobId NONE = UINT32_MAX;
+
+    // node pool, indexed by job id
+    std::vector<PairingNode> nodes;
+
+    // ids of finished jobs that can be handed out again
+    std::vector<JobId> freeIds;
+
+    JobId root = NONE;
+    int count = 0;
+
+    // storage for the names of all queued jobs, and the id of every queued job by name
+    NameArena names;
+    NameIndex jobIds;
+
+    // roots of the subtrees during a two-pass merge, kept to reuse the storage
+    std::vector<JobId> mergeRoots;
+
+    bool empty() const { return count == 0; }
+    int size() const { return count; }
+};
+
+
+
+// name of the job a key returned by topK belongs to
+inline std::string_view jobName(const PairingQueue &jobs, const HeapKey &key) {
+    return jobs.nodes[key.id].name.text;
+}
+
+
+
+// add a job. returns false (and changes nothing) if a job with that name is already queued
+bool pushJob(PairingQueue &jobs, std::string_view name, int priority);
+
+// remove the job with the highest priority into 'job'. returns false if the queue is empty
+bool popJob(PairingQueue &jobs, PrintJob &job);
+
+// copy the job with the highest priority into 'job', without removing it. returns false if the queue is empty
+bool peekJob(const PairingQueue &jobs, PrintJob &job);
+
+// change the priority of a queued job. returns false if no job with that name is queued
+bool changePriority(PairingQueue &jobs, std::string_view name, int new_priority);
+
+// remove a queued job, wherever it is in the tree: its subtree is cut out and its children
+// are melded back in, O(log n) amortized. returns false if no job with that name is queued
+bool removeJob(PairingQueue &jobs, std::string_view name);
+
+// make room for 'n' queued jobs in total, so adding that many jobs doesn't reallocate
+void reserveJobs(PairingQueue &jobs, int n);
+
+// keys of the k jobs with the highest priority (or of all jobs, if there are fewer), highest first.
+// the tree is not touched. unlike the array heap, a node can have any number of children, so this
+// costs O(k log k) plus the number of children of the nodes that are returned
+std::vector<HeapKey> topK(const PairingQueue &jobs, int k);
+
+#endif // MAXHEAP_PAIRING_QUEUE_H
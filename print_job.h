@@ -0,0 +1,20 @@
+#ifndef MAXHEAP_PRINT_JOB_H
+#define MAXHEAP_PRINT_JOB_H
+
+#include <string>
+#include <utility>
+
+
+
+// structure to represent a print job
+struct PrintJob {
+    std::string name;
+    int priority;
+
+    PrintJob () : priority(0) {}
+
+    PrintJob (std::string name, int priority)
+    : name(std::move(name)), priority(priority) {}
+};
+
+#endif // MAXHEAP_PRINT_JOB_H
@@ -0,0 +1,396 @@
+#include "print_queue.h"
+
+#include <algorithm> // for std::min, std::max, std::nth_element, std::sort
+
+#include "op_stats.h"
+
+
+
+// helper for recording the new index of a key that was moved inside the heap
+static void keyPlaced(PrintQueue &jobs, int i) {
+    jobs.positions[jobs.heap[i].id] = i;
+}
+
+
+
+// the key ordering used on the heap, counting every comparison
+static bool countedHigher(const HeapKey &a, const HeapKey &b) {
+    workCounters.comparisons++;
+    return higherKey(a, b);
+}
+
+
+
+// helper for sifting with the work counted, for threads that keep statistics. 'sift' is called with the comparison
+// and placement callbacks to use. every key placed is a move, and every placement but the sifted key's last one
+// is a level it travelled. threads without statistics call their sift with higherKey and keyPlaced directly,
+// so their sift loops stay exactly as they are without any counting
+template<typename Sift>
+static void countedSift(PrintQueue &jobs, Sift sift) {
+    std::uint64_t moved = 0;
+    sift(countedHigher, [&](int i) {
+        keyPlaced(jobs, i);
+        moved++;
+    });
+    workCounters.moves += moved;
+    if (moved > 1)
+        workCounters.levels += moved - 1;
+}
+
+
+
+// number of keys in the heap, including those of cancelled jobs
+static int heapSize(const PrintQueue &jobs) {
+    return static_cast<int>(jobs.heap.size());
+}
+
+
+
+// helper for handing out an id for a new job, reusing the id of a finished job if there is one
+static JobId allocateId(PrintQueue &jobs) {
+    if (!jobs.freeIds.empty()) {
+        JobId id = jobs.freeIds.back();
+        jobs.freeIds.pop_back();
+        return id;
+    }
+    jobs.records.emplace_back();
+    jobs.positions.push_back(-1);
+    return static_cast<JobId>(jobs.records.size() - 1);
+}
+
+
+
+// helper for removing a job's name from the index and only then handing its bytes back to the arena
+static void releaseName(PrintQueue &jobs, JobId id) {
+    NameRef &name = jobs.records[id].name;
+    jobs.jobIds.erase(name.text);
+    jobs.names.release(name);
+    name = NameRef();
+}
+
+
+
+// helper for making the id of a job whose key left the heap available again
+static void freeId(PrintQueue &jobs, JobId id) {
+    jobs.records[id].cancelled = false;
+    jobs.positions[id] = -1;
+    jobs.freeIds.push_back(id);
+}
+
+
+
+// pop keys of cancelled jobs off the top, so the root is always a queued job
+static void dropCancelledTop(PrintQueue &jobs) {
+    while (jobs.cancelledCount > 0 && !jobs.heap.empty() && jobs.records[jobs.heap.front().id].cancelled) {
+        HeapKey top = popTop(jobs.heap, higherKey, [&](int i) { keyPlaced(jobs, i); });
+        freeId(jobs, top.id);
+        jobs.cancelledCount--;
+    }
+}
+
+
+
+// function for restoring max-heap properties on a subtree rooted at parent based on priority.
+void heapify(PrintQueue &jobs, int n, int parent)  {
+    // the engine compares the parent against all of its children and keeps sifting down,
+    // reporting every move so the position table stays current
+    auto sift = [&](auto higher, auto placed) { siftDown(jobs.heap, n, parent, higher, placed); };
+    if (opStats.enabled) {
+        OpTimer timer(StatOp::Heapify);
+        countedSift(jobs, sift);
+    } else {
+        sift(higherKey, [&](int i) { keyPlaced(jobs, i); });
+    }
+}
+
+
+
+// function to restore heap properties after inserting a new node
+void heapifyInsertOperation(PrintQueue &jobs, int i) {
+    // move the node up for as long as its parent has a smaller priority.
+    // nothing happens if the parent has greater or equal priority than the new node
+    auto sift = [&](auto higher, auto placed) { siftUp(jobs.heap, i, higher, placed); };
+    if (opStats.enabled) {
+        OpTimer timer(StatOp::HeapifyInsert);
+        countedSift(jobs, sift);
+    } else {
+        sift(higherKey, [&](int j) { keyPlaced(jobs, j); });
+    }
+}
+
+
+
+bool appendJob(PrintQueue &jobs, std::string_view name, int priority) {
+    if (jobs.jobIds.find(name) != NameIndex::NOT_FOUND)
+        return false;
+
+    // store the name once in the arena, and let the index refer to that copy
+    JobId id = allocateId(jobs);
+    jobs.records[id].name = jobs.names.intern(name);
+    jobs.jobIds.insert(jobs.records[id].name.text, id);
+
+    // put the new key at the bottom of the heap
+    jobs.heap.push_back({priority, id});
+    jobs.positions[id] = heapSize(jobs) - 1;
+    return true;
+}
+
+
+
+bool pushJob(PrintQueue &jobs, std::string_view name, int priority) {
+    if (!appendJob(jobs, name, priority))
+        return false;
+
+    // sift the new key up from the bottom of the heap
+    heapifyInsertOperation(jobs, heapSize(jobs) - 1);
+    return true;
+}
+
+
+
+void reserveJobs(PrintQueue &jobs, int n) {
+    jobs.heap.reserve(n);
+    jobs.records.reserve(n);
+    jobs.positions.reserve(n);
+    jobs.jobIds.reserve(n);
+}
+
+
+
+void heapifyAppended(PrintQueue &jobs, int first) {
+    int n = heapSize(jobs);
+    int added = n - first;
+    if (added <= 0)
+        return;
+
+    // k single sift-ups cost up to k * log(n) comparisons, a rebuild costs about 2n.
+    // rebuild once the batch is big enough that the sift-ups could cost more than that
+    int depth = 1;
+    for (int levels = n; levels > 1; levels /= HEAP_ARITY)
+        depth++;
+
+    if (static_cast<long long>(added) * depth > 2LL * n) {
+        buildHeap(jobs.heap, n, higherKey, [&](int i) { keyPlaced(jobs, i); });
+        dropCancelledTop(jobs);
+    } else {
+        for (int i = first; i < n; i++)
+            heapifyInsertOperation(jobs, i);
+    }
+}
+
+
+
+bool popJob(PrintQueue &jobs, PrintJob &job) {
+    if (jobs.empty())
+        return false;
+
+    // remove the top key. the engine fills the root with Floyd's bottom-up deletion,
+    // reporting every key it moves so the position table stays current
+    HeapKey top;
+    auto sift = [&](auto higher, auto placed) { top = popTop(jobs.heap, higher, placed); };
+    if (opStats.enabled)
+        countedSift(jobs, sift);
+    else
+        sift(higherKey, [&](int i) { keyPlaced(jobs, i); });
+
+    job.name.assign(jobs.records[top.id].name.text);
+    job.priority = top.priority;
+
+    // remove the name from the index, to make room to create a new job with identical name
+    releaseName(jobs, top.id);
+    freeId(jobs, top.id);
+    dropCancelledTop(jobs);
+    return true;
+}
+
+
+
+bool peekJob(const PrintQueue &jobs, PrintJob &job) {
+    if (jobs.empty())
+        return false;
+
+    job.name.assign(jobName(jobs, jobs.heap.front()));
+    job.priority = jobs.heap.front().priority;
+    return true;
+}
+
+
+
+bool changePriority(PrintQueue &jobs, std::string_view name, int new_priority) {
+    // look up the job's heap index through its id instead of scanning the heap
+    JobId id = jobs.jobIds.find(name);
+    if (id == NameIndex::NOT_FOUND)
+        return false;
+    int index = jobs.positions[id];
+
+    int old_priority = jobs.heap[index].priority;
+    jobs.heap[index].priority = new_priority;
+
+    if (new_priority > old_priority) {
+        heapifyInsertOperation(jobs, index);
+    } else {
+        heapify(jobs, heapSize(jobs), index);
+        dropCancelledTop(jobs);
+    }
+    return true;
+}
+
+
+
+bool removeJob(PrintQueue &jobs, std::string_view name) {
+    JobId id = jobs.jobIds.find(name);
+    if (id == NameIndex::NOT_FOUND)
+        return false;
+    int index = jobs.positions[id];
+
+    // fill the hole with the last key. it came from the bottom, so it may belong above the removed key's parent,
+    // or below the removed key's children, but not both
+    HeapKey last = jobs.heap.back();
+    jobs.heap.pop_back();
+    if (index < heapSize(jobs)) {
+        jobs.heap[index] = last;
+        keyPlaced(jobs, index);
+        if (index > 0 && higherKey(last, jobs.heap[DaryLayout<HEAP_ARITY>::parent(index)]))
+            heapifyInsertOperation(jobs, index);
+        else
+            heapify(jobs, heapSize(jobs), index);
+    }
+
+    releaseName(jobs, id);
+    freeId(jobs, id);
+    dropCancelledTop(jobs);
+    return true;
+}
+
+
+
+bool cancelJob(PrintQueue &jobs, std::string_view name) {
+    if (jobs.maxCancelledShare <= 0.0)
+        return removeJob(jobs, name);
+
+    JobId id = jobs.jobIds.find(name);
+    if (id == NameIndex::NOT_FOUND)
+        return false;
+
+    // the name goes right away, so a new job may use it. the key stays until it comes up or the heap is compacted
+    releaseName(jobs, id);
+    jobs.records[id].cancelled = true;
+    jobs.cancelledCount++;
+
+    if (jobs.positions[id] == 0)
+        dropCancelledTop(jobs);
+    else if (jobs.cancelledCount > jobs.maxCancelledShare * heapSize(jobs))
+        compactJobs(jobs);
+    return true;
+}
+
+
+
+void compactJobs(PrintQueue &jobs) {
+    if (jobs.cancelledCount == 0)
+        return;
+
+    // keep the keys of queued jobs in their current order, which is already close to a heap
+    int kept = 0;
+    for (const auto &key : jobs.heap) {
+        if (jobs.records[key.id].cancelled)
+            freeId(jobs, key.id);
+        else
+            jobs.heap[kept++] = key;
+    }
+    jobs.heap.resize(kept);
+    jobs.cancelledCount = 0;
+
+    for (int i = 0; i < kept; i++)
+        keyPlaced(jobs, i);
+    buildHeap(jobs.heap, kept, higherKey, [&](int i) { keyPlaced(jobs, i); });
+}
+
+
+
+void takeTopKeys(PrintQueue &jobs, int k, std::vector<HeapKey> &taken) {
+    int n = heapSize(jobs);
+    k = std::min(std::max(k, 0), jobs.size());
+    taken.clear();
+    taken.reserve(k);
+
+    // same trade-off as for bulk inserts: k pops cost about k * depth, a selection plus rebuild about 2n
+    int depth = 1;
+    for (int levels = n; levels > 1; levels /= HEAP_ARITY)
+        depth++;
+
+    if (static_cast<long long>(k) * depth <= 2LL * n) {
+        for (int i = 0; i < k; i++) {
+            HeapKey top = popTop(jobs.heap, higherKey, [&](int j) { keyPlaced(jobs, j); });
+            jobs.positions[top.id] = -1;
+            taken.push_back(top);
+            dropCancelledTop(jobs);
+        }
+        return;
+    }
+
+    // the partition below can't skip cancelled keys, so drop them first. that is O(n), like the partition
+    compactJobs(jobs);
+
+    // partition the heap array around the k-th best key, which is O(n) and touches memory in order,
+    // then sort just the k best keys for the caller
+    std::nth_element(jobs.heap.begin(), jobs.heap.begin() + k, jobs.heap.end(), higherKey);
+    taken.assign(jobs.heap.begin(), jobs.heap.begin() + k);
+    std::sort(taken.begin(), taken.end(), higherKey);
+    for (const auto &key : taken)
+        jobs.positions[key.id] = -1;
+
+    // the rest of the keys become the new heap, rebuilt bottom-up
+    jobs.heap.erase(jobs.heap.begin(), jobs.heap.begin() + k);
+    int kept = heapSize(jobs);
+    for (int i = 0; i < kept; i++)
+        keyPlaced(jobs, i);
+    buildHeap(jobs.heap, kept, higherKey, [&](int i) { keyPlaced(jobs, i); });
+}
+
+
+
+void retireJobs(PrintQueue &jobs, const std::vector<HeapKey> &taken) {
+    // once the queue is drained, the whole index can go at once. that walks every slot of the table though,
+    // so it only pays off when the batch is a large share of it. a table that once held many jobs and is
+    // drained a few jobs at a time erases them one by one instead
+    bool drained = jobs.empty() && taken.size() * 8 >= jobs.jobIds.capacity();
+    if (drained)
+        jobs.jobIds.clear();
+
+    for (const auto &key : taken) {
+        NameRef &name = jobs.records[key.id].name;
+        if (!drained)
+            jobs.jobIds.erase(name.text);
+        jobs.names.release(name);
+        name = NameRef();
+        jobs.freeIds.push_back(key.id);
+    }
+}
+
+
+
+int popBatch(PrintQueue &jobs, int k, std::vector<PrintJob> &out) {
+    return popBatch(jobs, k, [&](std::string_view name, int priority) {
+        out.emplace_back(std::string(name), priority);
+    });
+}
+
+
+
+std::vector<HeapKey> topK(const PrintQueue &jobs, int k) {
+    std::vector<HeapKey> keys;
+    keys.reserve(std::min(std::max(k, 0), jobs.size()));
+    auto visit = [&](int i) {
+        // keys of cancelled jobs are passed over, and don't count towards k
+        if (jobs.records[jobs.heap[i].id].cancelled)
+            return false;
+        keys.push_back(jobs.heap[i]);
+        return true;
+    };
+    if (opStats.enabled)
+        visitTopK(jobs.heap, k, countedHigher, visit);
+    else
+        visitTopK(jobs.heap, k, higherKey, visit);
+    return keys;
+}
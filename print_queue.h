@@ -0,0 +1,196 @@
+#ifndef MAXHEAP_PRINT_QUEUE_H
+#define MAXHEAP_PRINT_QUEUE_H
+
+#include <cstdint>
+#include <iterator>  // for std::size
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "print_job.h"
+#include "dary_heap.h"
+#include "name_arena.h"
+#include "name_index.h"
+
+
+
+// id of a job in the side table. ids of finished jobs are reused
+using JobId = std::uint32_t;
+
+
+
+// what the heap actually stores: just the priority and the id of the job it belongs to.
+// at 8 bytes, eight of these fit in one cache line, so sifting never pulls job names into the cache
+struct HeapKey {
+    int priority;
+    JobId id;
+};
+
+static_assert(sizeof(HeapKey) == 8, "heap keys should stay 8 bytes");
+
+
+
+// same ordering as for whole print jobs: higher priority belongs closer to the root
+inline bool higherKey(const HeapKey &a, const HeapKey &b) {
+    return a.priority > b.priority;
+}
+
+
+
+// everything about a job that the heap doesn't need for ordering, indexed by job id
+struct JobRecord {
+    // the name is interned in the queue's arena, so a job never owns a string allocation
+    NameRef name;
+
+    // set when the job was cancelled lazily, while its key is still in the heap (see cancelJob)
+    bool cancelled = false;
+};
+
+
+
+// the print queue: a d-ary heap of keys, plus side tables for the job data.
+// the arity is picked at compile time (see dary_heap.h), none of the functions below depend on it
+struct PrintQueue {
+    // heap of (priority, id) keys
+    DaryHeap<HeapKey, HEAP_ARITY> heap;
+
+    // job data by id
+    std::vector<JobRecord> records;
+
+    // current index in the heap by id, kept up to date on every move
+    std::vector<int> positions;
+
+    // ids of finished jobs that can be handed out again
+    std::vector<JobId> freeIds;
+
+    // storage for the names of all queued jobs
+    NameArena names;
+
+    // id of every queued job by name, referring to the names in the arena. gives O(1) lookup of
+    // a job by name, and since every name has exactly one entry it is also used to avoid duplicate print jobs
+    NameIndex jobIds;
+
+    // keys taken out by the last popBatch, kept to reuse the storage
+    std::vector<HeapKey> batchKeys;
+
+    // share of cancelled keys the heap may hold before it is compacted. 0 means cancelJob removes jobs right away
+    double maxCancelledShare = 0.0;
+
+    // keys in the heap that belong to cancelled jobs. the root is never one of them
+    int cancelledCount = 0;
+
+    bool empty() const { return heap.empty(); }
+    int size() const { return static_cast<int>(heap.size()) - cancelledCount; }
+};
+
+
+
+// name of the job a heap key belongs to
+inline std::string_view jobName(const PrintQueue &jobs, const HeapKey &key) {
+    return jobs.records[key.id].name.text;
+}
+
+
+
+// restore max-heap properties on the subtree rooted at parent, considering the first n keys
+void heapify(PrintQueue &jobs, int n, int parent);
+
+// restore heap properties after the key at index i was inserted or had its priority raised
+void heapifyInsertOperation(PrintQueue &jobs, int i);
+
+// add a job. returns false (and changes nothing) if a job with that name is already queued
+bool pushJob(PrintQueue &jobs, std::string_view name, int priority);
+
+// remove the job with the highest priority into 'job'. returns false if the queue is empty
+bool popJob(PrintQueue &jobs, PrintJob &job);
+
+// copy the job with the highest priority into 'job', without removing it. returns false if the queue is empty
+bool peekJob(const PrintQueue &jobs, PrintJob &job);
+
+// change the priority of a queued job. returns false if no job with that name is queued
+bool changePriority(PrintQueue &jobs, std::string_view name, int new_priority);
+
+// remove a queued job, wherever it is in the heap: the last key fills its place and is sifted whichever way
+// it has to go, so this is O(log n). returns false if no job with that name is queued
+bool removeJob(PrintQueue &jobs, std::string_view name);
+
+// cancel a queued job. if the queue allows cancelled keys (maxCancelledShare > 0), the job is only marked, its name
+// is freed right away and its key is skipped once it comes up, which makes cancelling many jobs cheap. once more
+// than maxCancelledShare of the heap is cancelled keys, they are all dropped in one pass. otherwise this is removeJob.
+// returns false if no job with that name is queued
+bool cancelJob(PrintQueue &jobs, std::string_view name);
+
+// drop the keys of all cancelled jobs from the heap and rebuild it, in O(n)
+void compactJobs(PrintQueue &jobs);
+
+// make room for 'n' queued jobs in total, so adding that many jobs doesn't reallocate
+void reserveJobs(PrintQueue &jobs, int n);
+
+// append a job at the bottom of the heap *without* restoring the heap property, as the first half of a
+// bulk insert. returns false (and changes nothing) if a job with that name is already queued or appended
+bool appendJob(PrintQueue &jobs, std::string_view name, int priority);
+
+// second half of a bulk insert: restore the heap property after the keys from index 'first' onward were appended.
+// if the batch is large compared to the heap, the whole heap is rebuilt bottom-up in O(n),
+// otherwise every appended key is sifted up on its own
+void heapifyAppended(PrintQueue &jobs, int first);
+
+// add a whole batch of jobs (anything with .name and .priority) at once.
+// names that are already queued, or repeated within the batch, are skipped and added to 'rejected' if given.
+// returns the number of jobs that were added
+template<typename Range>
+int insertBatch(PrintQueue &jobs, const Range &batch, std::vector<std::string> *rejected = nullptr) {
+    int queued = jobs.size();
+    int first = static_cast<int>(jobs.heap.size());
+
+    // all storage is grown once up front, not once per job
+    if constexpr (requires { std::size(batch); })
+        reserveJobs(jobs, first + static_cast<int>(std::size(batch)));
+
+    // the index already holds the names appended so far, so this one pass
+    // checks the whole batch against both the queue and itself
+    for (const auto &job : batch) {
+        if (!appendJob(jobs, job.name, job.priority) && rejected)
+            rejected->emplace_back(job.name);
+    }
+
+    heapifyAppended(jobs, first);
+    return jobs.size() - queued;
+}
+
+// first half of a batched pop: move the keys of the k jobs with the highest priority (or of all jobs, if
+// there are fewer) out of the heap into 'taken', highest first. keys of cancelled jobs are dropped on the
+// way, and the jobs' names stay valid until retireJobs.
+// for small k this is k single pops; when k is large compared to the heap, the k best keys are partitioned
+// off in one pass and the rest of the heap is rebuilt bottom-up, which is O(n + k log k) instead of O(k log n)
+void takeTopKeys(PrintQueue &jobs, int k, std::vector<HeapKey> &taken);
+
+// second half of a batched pop: release the ids, names and index entries of jobs taken out of the heap.
+// the names are erased from the index one by one, unless the queue is empty afterwards and the batch was
+// large, at least an eighth of the index's slots (taken.size() * 8 >= jobIds.capacity()). then the index
+// is cleared in one go, which walks every slot but is cheaper than that many erases
+void retireJobs(PrintQueue &jobs, const std::vector<HeapKey> &taken);
+
+// remove up to k jobs with the highest priority in one call, highest first, and hand each of them to
+// 'sink(std::string_view name, int priority)'. the name is only valid during the call, and the sink must
+// not change the queue. returns the number of jobs removed
+template<typename Sink>
+int popBatch(PrintQueue &jobs, int k, Sink sink) {
+    std::vector<HeapKey> &taken = jobs.batchKeys;
+    takeTopKeys(jobs, k, taken);
+
+    for (const auto &key : taken)
+        sink(jobName(jobs, key), key.priority);
+
+    retireJobs(jobs, taken);
+    return static_cast<int>(taken.size());
+}
+
+// same as above, appending the removed jobs to 'out'
+int popBatch(PrintQueue &jobs, int k, std::vector<PrintJob> &out);
+
+// keys of the k jobs with the highest priority (or of all jobs, if there are fewer), highest first.
+// the heap itself is not touched, and the cost is O(k log k) no matter how many jobs are queued
+std::vector<HeapKey> topK(const PrintQueue &jobs, int k);
+
+#endif // MAXHEAP_PRINT_QUEUE_H
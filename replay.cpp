@@ -0,0 +1,165 @@
+#include <iostream>                     // replays a recorded trace against the print queue
+#include <algorithm> // for std::sort
+#include <chrono>
+#include <cstdlib>   // for mkdtemp
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "job_queue.h"
+#include "trace.h"
+
+
+
+// clock used for all measurements
+using ReplayClock = std::chrono::steady_clock;
+
+// operations a trace can hold, in the order of TraceOp
+constexpr int TRACE_OPS = 5;
+const char *const OP_NAMES[TRACE_OPS] = {"insert", "pop", "update", "cancel", "display"};
+
+
+
+// run one operation from the trace on the queue, the way the interactive program would, minus the output.
+// a listing still walks the jobs it would show and reads their names. returns something to add to the checksum
+long long replayEvent(JobQueue &jobs, const TraceEvent &event) {
+    PrintJob job;
+    switch (event.op) {
+        case TraceOp::Insert: {
+#if MAXHEAP_BOUNDED_QUEUE
+            PrintJob evicted;
+            return static_cast<long long>(offerJob(jobs, event.name, event.value, evicted));
+#else
+            return pushJob(jobs, event.name, event.value);
+#endif
+        }
+        case TraceOp::Pop: {
+            if (!popJob(jobs, job))
+                return 0;
+#if MAXHEAP_AGING_QUEUE
+            advanceEpoch(jobs);
+#endif
+            return job.priority;
+        }
+        case TraceOp::Update:
+            return changePriority(jobs, event.name, event.value);
+        case TraceOp::Cancel:
+            return removeJob(jobs, event.name);
+        case TraceOp::Display: {
+            int limit = event.value < 0 || event.value > jobs.size() ? jobs.size() : event.value;
+            long long shown = 0;
+            for (const auto &key : topK(jobs, limit))
+                shown += static_cast<long long>(jobName(jobs, key).size()) + key.priority;
+            return shown;
+        }
+    }
+    return 0;
+}
+
+
+
+// print the 50th, 99th and 99.9th percentile and the maximum of a list of latencies
+void printPercentiles(const char *label, std::vector<long long> &nanos) {
+    if (nanos.empty())
+        return;
+    std::sort(nanos.begin(), nanos.end());
+    auto at = [&](double q) { return nanos[static_cast<std::size_t>(q * (nanos.size() - 1))]; };
+    std::cout << label << "\t" << nanos.size() << " ops\tp50 " << at(0.5) << " ns\tp99 " << at(0.99) << " ns\tp99.9 "
+              << at(0.999) << " ns\tmax " << nanos.back() << " ns" << std::endl;
+}
+
+
+
+int main(int argc, char **argv) {
+    // arguments: [--paced] <trace>. without --paced the trace runs as fast as possible, with it every operation
+    // waits for its recorded time. the latency of a paced operation is counted from that time, so an operation
+    // that had to wait for the ones before it shows that wait
+    bool paced = false;
+    int arg = 1;
+    if (arg < argc && std::string_view(argv[arg]) == "--paced") {
+        paced = true;
+        arg++;
+    }
+    if (arg >= argc) {
+        std::cerr << "Usage: " << argv[0] << " [--paced] <trace>" << std::endl;
+        return 1;
+    }
+
+    std::vector<TraceEvent> events;
+    if (!readTrace(argv[arg], events)) {
+        std::cerr << "Error: \"" << argv[arg] << "\" is not a trace." << std::endl;
+        return 1;
+    }
+
+    JobQueue jobs;
+#if MAXHEAP_MAPPED_QUEUE
+    // the mapped queue needs files of its own. they go in a new directory of their own, so replays running
+    // at the same time, or files someone else keeps in the temp directory, are never touched
+    std::string directory = (std::filesystem::temp_directory_path() / "maxheap_replay.XXXXXX").string();
+    if (::mkdtemp(directory.data()) == nullptr) {
+        std::cerr << "Error: Can't create a directory for the print queue." << std::endl;
+        return 1;
+    }
+    std::string path = directory + "/queue";
+    if (!openJobs(jobs, path)) {
+        std::cerr << "Error: Can't open the print queue in \"" << path << "\"." << std::endl;
+        std::filesystem::remove_all(directory);
+        return 1;
+    }
+#endif
+
+    std::vector<long long> latencies[TRACE_OPS];
+    for (auto &list : latencies)
+        list.reserve(events.size());
+    long long checksum = 0;
+    long skipped = 0;
+
+    auto start = ReplayClock::now();
+    for (const auto &event : events) {
+        int op = static_cast<int>(event.op) - 1;
+        if (op < 0 || op >= TRACE_OPS) {
+            skipped++;
+            continue;
+        }
+
+        auto begin = ReplayClock::now();
+        if (paced) {
+            // an operation that is late was held up by the ones before it, so it counts from when it was due.
+            // one that is early waits, and counts from when it woke up, the oversleeping isn't the queue's fault
+            auto due = start + std::chrono::nanoseconds(event.time);
+            if (begin < due) {
+                std::this_thread::sleep_until(due);
+                begin = ReplayClock::now();
+            } else {
+                begin = due;
+            }
+        }
+        checksum += replayEvent(jobs, event);
+        latencies[op].push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(ReplayClock::now() - begin).count());
+    }
+    double seconds = std::chrono::duration<double>(ReplayClock::now() - start).count();
+
+    long replayed = static_cast<long>(events.size()) - skipped;
+    std::cout << "replayed " << replayed << " operations " << (paced ? "at recorded pacing" : "as fast as possible")
+              << " in " << seconds * 1000 << " ms\t" << (seconds > 0 ? replayed / seconds : 0.0) << " ops/s"
+              << "\t(" << jobs.size() << " jobs left, checksum " << checksum << ")" << std::endl;
+    if (!events.empty())
+        std::cout << "recorded over " << events.back().time / 1e6 << " ms" << std::endl;
+    if (skipped > 0)
+        std::cout << skipped << " records of unknown operations were skipped" << std::endl;
+
+    std::vector<long long> all;
+    for (int op = 0; op < TRACE_OPS; op++) {
+        all.insert(all.end(), latencies[op].begin(), latencies[op].end());
+        printPercentiles(OP_NAMES[op], latencies[op]);
+    }
+    printPercentiles("all", all);
+
+#if MAXHEAP_MAPPED_QUEUE
+    closeJobs(jobs);
+    std::filesystem::remove_all(directory);
+#endif
+    return 0;
+}
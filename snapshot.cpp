@@ -0,0 +1,267 @@
+#include "snapshot.h"
+
+#include <cerrno>
+#include <cstring>   // for std::memcpy, std::memcmp
+#include <fcntl.h>
+#include <filesystem>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+
+
+// first bytes of every snapshot file
+static constexpr char SNAPSHOT_MAGIC[8] = {'M', 'H', 'S', 'N', 'A', 'P', 'S', 'H'};
+
+// set in the header when the keys are not in heap order, because cancelled jobs were left out
+static constexpr std::uint32_t KEYS_NOT_HEAP = 1;
+
+struct SnapshotHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t arity;
+    std::uint64_t count;
+    std::uint64_t nameBytes;
+    std::uint32_t flags;
+    std::uint32_t generation;
+    std::uint64_t checksum;
+};
+
+static_assert(sizeof(SnapshotHeader) == 48, "the snapshot header has a fixed size");
+
+
+
+// 64-bit checksum over a range of bytes, continuing from 'hash'. works on whole 8-byte words, so it keeps up
+// with reading the file. not cryptographic, just enough to notice a damaged or truncated snapshot
+static std::uint64_t checksum(const void *data, std::size_t size, std::uint64_t hash) {
+    const char *bytes = static_cast<const char *>(data);
+    auto mix = [&](std::uint64_t word) {
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+        hash ^= hash >> 29;
+    };
+
+    std::size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, bytes + i, 8);
+        mix(word);
+    }
+    if (i < size) {
+        std::uint64_t word = 0;
+        std::memcpy(&word, bytes + i, size - i);
+        mix(word ^ (static_cast<std::uint64_t>(size - i) << 56));
+    }
+    return hash;
+}
+
+
+
+// helper for writing a whole buffer, however many write calls that takes
+static bool writeAll(int fd, const void *data, std::size_t size) {
+    const char *bytes = static_cast<const char *>(data);
+    while (size > 0) {
+        ssize_t written = ::write(fd, bytes, size);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        bytes += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+
+
+// helper for reading exactly 'size' bytes. returns false on an error or if the file ends first
+static bool readAll(int fd, void *data, std::size_t size) {
+    char *bytes = static_cast<char *>(data);
+    while (size > 0) {
+        ssize_t got = ::read(fd, bytes, size);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0)
+            return false;
+        bytes += got;
+        size -= static_cast<std::size_t>(got);
+    }
+    return true;
+}
+
+
+
+bool saveSnapshot(const PrintQueue &jobs, const std::string &path, std::uint32_t generation) {
+    // lay the three sections out in memory first, renumbering the jobs by array index
+    std::vector<HeapKey> keys;
+    std::vector<std::uint32_t> nameEnds;
+    std::vector<char> names;
+    keys.reserve(jobs.size());
+    nameEnds.reserve(jobs.size());
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.arity = HEAP_ARITY;
+    header.generation = generation;
+
+    for (const auto &key : jobs.heap) {
+        const JobRecord &record = jobs.records[key.id];
+        if (record.cancelled) {
+            header.flags |= KEYS_NOT_HEAP;
+            continue;
+        }
+        if (names.size() + record.name.text.size() > UINT32_MAX)
+            return false;
+
+        keys.push_back({key.priority, static_cast<JobId>(keys.size())});
+        names.insert(names.end(), record.name.text.begin(), record.name.text.end());
+        nameEnds.push_back(static_cast<std::uint32_t>(names.size()));
+    }
+
+    header.count = keys.size();
+    header.nameBytes = names.size();
+    std::uint64_t sum = checksum(keys.data(), keys.size() * sizeof(HeapKey), 0);
+    sum = checksum(nameEnds.data(), nameEnds.size() * sizeof(std::uint32_t), sum);
+    header.checksum = checksum(names.data(), names.size(), sum);
+
+    std::string temporary = path + ".tmp";
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return false;
+
+    bool ok = writeAll(fd, &header, sizeof(header)) &&
+              writeAll(fd, keys.data(), keys.size() * sizeof(HeapKey)) &&
+              writeAll(fd, nameEnds.data(), nameEnds.size() * sizeof(std::uint32_t)) &&
+              writeAll(fd, names.data(), names.size()) &&
+              ::fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+
+    // only a complete snapshot replaces the old one
+    if (!ok || ::rename(temporary.c_str(), path.c_str()) != 0) {
+        ::unlink(temporary.c_str());
+        return false;
+    }
+
+    // the rename itself has to be on disk too, before the job log is started over after this snapshot
+    std::string directory = std::filesystem::path(path).parent_path().string();
+    int dir = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir < 0)
+        return false;
+    ok = ::fsync(dir) == 0;
+    ::close(dir);
+    return ok;
+}
+
+
+
+bool loadSnapshot(PrintQueue &jobs, const std::string &path, std::uint32_t &generation) {
+    // the snapshot replaces the whole queue, jobs already in it would be left in the index with ids that get reused
+    if (!jobs.empty())
+        return false;
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    SnapshotHeader header{};
+    struct stat info {};
+    bool ok = ::fstat(fd, &info) == 0 && readAll(fd, &header, sizeof(header)) &&
+              std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0 &&
+              header.version == SNAPSHOT_VERSION && header.count <= INT32_MAX;
+
+    // the sizes in the header have to add up to the file size, before anything is allocated for them
+    std::uint64_t bodyBytes = header.count * (sizeof(HeapKey) + sizeof(std::uint32_t)) + header.nameBytes;
+    ok = ok && header.nameBytes <= UINT32_MAX &&
+         static_cast<std::uint64_t>(info.st_size) == sizeof(header) + bodyBytes;
+
+    // one read per section, the keys straight into the heap array
+    int n = static_cast<int>(header.count);
+    std::vector<std::uint32_t> nameEnds;
+    std::vector<char> names;
+    if (ok) {
+        jobs.heap.resize(n);
+        nameEnds.resize(n);
+        names.resize(header.nameBytes);
+        ok = readAll(fd, jobs.heap.data(), n * sizeof(HeapKey)) &&
+             readAll(fd, nameEnds.data(), n * sizeof(std::uint32_t)) &&
+             readAll(fd, names.data(), names.size());
+    }
+    ::close(fd);
+
+    if (ok) {
+        std::uint64_t sum = checksum(jobs.heap.data(), n * sizeof(HeapKey), 0);
+        sum = checksum(nameEnds.data(), nameEnds.size() * sizeof(std::uint32_t), sum);
+        ok = checksum(names.data(), names.size(), sum) == header.checksum;
+
+        // name ends have to be in order, and the last one the end of the blob
+        for (int i = 1; ok && i < n; i++)
+            ok = nameEnds[i - 1] <= nameEnds[i];
+        ok = ok && (n == 0 ? names.empty() : nameEnds[n - 1] == names.size());
+    }
+    if (!ok) {
+        jobs.heap.clear();
+        return false;
+    }
+
+    // the job with id i is the one at index i
+    jobs.records.assign(n, JobRecord());
+    jobs.positions.resize(n);
+    jobs.freeIds.clear();
+    jobs.jobIds.reserve(n);
+    std::uint32_t start = 0;
+    for (int i = 0; i < n; i++) {
+        std::uint32_t end = nameEnds[i];
+        jobs.heap[i].id = static_cast<JobId>(i);
+        jobs.positions[i] = i;
+        jobs.records[i].name = jobs.names.intern(std::string_view(names.data() + start, end - start));
+        start = end;
+    }
+
+    // the index is filled in a second pass, loading the slot of a name a few names ahead of the one being inserted.
+    // with millions of names every insert misses the cache, and this lets the misses overlap.
+    // a name that is already there means a damaged or hand-made file, the queue would get two jobs of that name
+    constexpr int PREFETCH_DISTANCE = 16;
+    for (int i = 0; i < n; i++) {
+        if (i + PREFETCH_DISTANCE < n)
+            jobs.jobIds.prefetch(jobs.records[i + PREFETCH_DISTANCE].name.text);
+        if (jobs.jobIds.find(jobs.records[i].name.text) != NameIndex::NOT_FOUND) {
+            jobs.jobIds.clear();
+            for (const auto &record : jobs.records)
+                jobs.names.release(record.name);
+            jobs.records.clear();
+            jobs.positions.clear();
+            jobs.heap.clear();
+            return false;
+        }
+        jobs.jobIds.insert(jobs.records[i].name.text, static_cast<JobId>(i));
+    }
+
+    if (header.arity != HEAP_ARITY || (header.flags & KEYS_NOT_HEAP))
+        buildHeap(jobs.heap, n, higherKey, [&](int i) { jobs.positions[jobs.heap[i].id] = i; });
+    generation = header.generation;
+    return true;
+}
+
+
+
+void applyLogChanges(PrintQueue &jobs, const std::vector<LogChange> &changes) {
+    std::vector<PrintJob> added;
+    for (const auto &change : changes) {
+        switch (change.op) {
+            case LogOp::Insert:
+                added.emplace_back(change.name, change.priority);
+                break;
+            case LogOp::Update:
+                changePriority(jobs, change.name, change.priority);
+                break;
+            case LogOp::Cancel:
+                removeJob(jobs, change.name);
+                break;
+            case LogOp::Pop:
+            case LogOp::Snapshot:
+                break;
+        }
+    }
+    insertBatch(jobs, added);
+}
@@ -0,0 +1,44 @@
+#ifndef MAXHEAP_SNAPSHOT_H
+#define MAXHEAP_SNAPSHOT_H
+
+#include <string>
+#include <vector>
+
+#include "job_log.h"
+#include "print_queue.h"
+
+
+
+// binary snapshot of a PrintQueue, laid out so loading it is a few bulk reads and no heap work.
+// current layout (version 1), in native byte order:
+//
+//   header    magic "MHSNAPSH", u32 version, u32 arity, u64 job count, u64 name bytes, u32 flags, u32 generation,
+//             u64 checksum of everything after the header
+//   keys      one (i32 priority, u32 id) record per job, in heap array order. the id is the job's index in the
+//             name table, which is the same as its index in the array
+//   name ends u32 per job: where the job's name ends in the name blob. it starts where the previous one ends
+//   name blob all names back to back
+//
+// the keys are the heap array itself, so if the snapshot was written with the same arity the array already
+// has the heap property, and loading just reads it into place.
+//
+// the generation ties a snapshot to the job log: the log holds a marker with the same generation where the snapshot
+// was taken, and only the records after that marker still have to be replayed on top of it (see readJobLogTail)
+constexpr std::uint32_t SNAPSHOT_VERSION = 1;
+
+// write all queued jobs to 'path', as snapshot 'generation'. the file is written next to it first and renamed into
+// place once it is complete and synced, so a crash during a snapshot leaves the previous one intact.
+// returns false on any error
+bool saveSnapshot(const PrintQueue &jobs, const std::string &path, std::uint32_t generation);
+
+// load a snapshot into an empty queue, and set 'generation' to the one it was saved as. returns false (and leaves
+// the queue empty) if the queue isn't empty, or if the file can't be read, isn't a snapshot of a version this build
+// knows, fails its checksum or has a name in it twice. snapshots written with another heap arity, or of a queue
+// that had cancelled jobs in it, still load, but their heap is rebuilt bottom-up in O(n)
+bool loadSnapshot(PrintQueue &jobs, const std::string &path, std::uint32_t &generation);
+
+// apply the changes logged after a snapshot (see readJobLogTail) to the queue loaded from it. updates and cancels
+// are done job by job, the jobs that weren't in the snapshot are added with one insertBatch
+void applyLogChanges(PrintQueue &jobs, const std::vector<LogChange> &changes);
+
+#endif // MAXHEAP_SNAPSHOT_H
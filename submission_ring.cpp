@@ -0,0 +1,25 @@
+#include "submission_ring.h"
+
+
+
+SubmissionRing::SubmissionRing(std::size_t capacity) {
+    std::size_t size = 2;
+    while (size < capacity)
+        size *= 2;
+
+    slots.reset(new Slot[size]);
+    mask = size - 1;
+
+    // every slot starts out free for the first lap
+    for (std::size_t i = 0; i < size; i++)
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    batch.reserve(size);
+}
+
+
+
+int mergeSubmissions(PrintQueue &jobs, SubmissionRing &ring, int maxJobs, std::vector<std::string> *rejected) {
+    return ring.consume(maxJobs, [&](const std::vector<SubmittedJob> &batch) {
+        insertBatch(jobs, batch, rejected);
+    });
+}
@@ -0,0 +1,130 @@
+#ifndef MAXHEAP_SUBMISSION_RING_H
+#define MAXHEAP_SUBMISSION_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>   // for std::memcpy
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "print_queue.h"
+
+
+
+// a job as it was submitted through the ring. the name points into the ring and is only valid while it is consumed
+struct SubmittedJob {
+    std::string_view name;
+    int priority;
+};
+
+
+
+// bounded lock-free ring buffer for job submissions, with many producers and one consumer.
+// submitting threads never touch the heap: they claim a slot with one compare-and-swap, copy the job into it
+// and publish it. the thread that owns the PrintQueue takes everything that was published in one batch,
+// and merges it into the heap with a single insertBatch.
+//
+// every slot has a sequence number telling whose turn it is (this is Dmitry Vyukov's bounded queue):
+// for the slot at position p it is p while the slot is free to be written, p + 1 once the job in it is
+// published, and p + capacity once the consumer is done with it, which is the free value for the next lap
+class SubmissionRing {
+public:
+    // longest name a slot can carry. names are copied into the slot itself, so submitting never allocates
+    static constexpr std::size_t MAX_NAME = 48;
+
+    enum class PushResult { Pushed, Full, NameTooLong };
+
+    // 'capacity' is rounded up to a power of two
+    explicit SubmissionRing(std::size_t capacity);
+
+    // submit a job. never blocks: if the ring is full, the caller decides whether to retry or shed the job
+    PushResult tryPush(std::string_view name, int priority) {
+        if (name.size() > MAX_NAME)
+            return PushResult::NameTooLong;
+
+        std::uint64_t pos = enqueuePos.load(std::memory_order_relaxed);
+        Slot *slot;
+        while (true) {
+            slot = &slots[pos & mask];
+            std::uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+            auto difference = static_cast<std::int64_t>(sequence - pos);
+
+            if (difference == 0) {
+                // the slot is free for this position, try to claim it
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (difference < 0) {
+                // the consumer hasn't freed this slot from the previous lap yet
+                return PushResult::Full;
+            } else {
+                // another producer claimed the position first
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->priority = priority;
+        slot->length = static_cast<std::uint32_t>(name.size());
+        std::memcpy(slot->name, name.data(), name.size());
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return PushResult::Pushed;
+    }
+
+    // consumer side: hand up to 'maxJobs' published jobs, in submission order, to 'consume(const std::vector<SubmittedJob> &)'
+    // in one call, then free their slots. only one thread may consume. returns the number of jobs consumed
+    template<typename Consume>
+    int consume(int maxJobs, Consume consume) {
+        batch.clear();
+        std::uint64_t pos = dequeuePos;
+        while (static_cast<int>(batch.size()) < maxJobs) {
+            Slot &slot = slots[pos & mask];
+            if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+                break;
+            batch.push_back({std::string_view(slot.name, slot.length), slot.priority});
+            pos++;
+        }
+        if (batch.empty())
+            return 0;
+
+        consume(static_cast<const std::vector<SubmittedJob> &>(batch));
+
+        // only now the names in the batch may be overwritten
+        for (; dequeuePos < pos; dequeuePos++)
+            slots[dequeuePos & mask].sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+        return static_cast<int>(batch.size());
+    }
+
+    std::size_t capacity() const { return mask + 1; }
+
+private:
+    // one submission. exactly one cache line, so producers writing neighbouring slots don't share lines
+    struct alignas(CACHE_LINE_SIZE) Slot {
+        std::atomic<std::uint64_t> sequence;
+        int priority;
+        std::uint32_t length;
+        char name[MAX_NAME];
+    };
+
+    static_assert(sizeof(Slot) == CACHE_LINE_SIZE, "a slot should fill exactly one cache line");
+
+    std::unique_ptr<Slot[]> slots;
+    std::uint64_t mask;
+
+    // next position to claim, shared by all producers
+    alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> enqueuePos{0};
+
+    // consumer-only state
+    alignas(CACHE_LINE_SIZE) std::uint64_t dequeuePos = 0;
+    std::vector<SubmittedJob> batch;
+};
+
+
+
+// take up to 'maxJobs' submissions out of the ring and merge them into the heap with one insertBatch.
+// to be called by the thread that owns the queue. names that are already queued are skipped and added to
+// 'rejected' if given. returns the number of submissions taken out of the ring
+int mergeSubmissions(PrintQueue &jobs, SubmissionRing &ring, int maxJobs, std::vector<std::string> *rejected = nullptr);
+
+#endif // MAXHEAP_SUBMISSION_RING_H
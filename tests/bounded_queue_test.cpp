@@ -0,0 +1,185 @@
+#include <iostream>                     // randomized check of the bounded queue's max-min heap
+#include <algorithm> // for std::sort
+#include <functional> // for std::greater
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bounded_queue.h"
+
+
+
+// number of failed checks so far. the first few are printed
+int failures = 0;
+
+void check(bool ok, const std::string &what, int seed, int step) {
+    if (ok)
+        return;
+    if (failures < 10)
+        std::cerr << "seed " << seed << ", step " << step << ": " << what << std::endl;
+    failures++;
+}
+
+
+
+// helper for telling if index i is on a max level, counting the root's level as the first one
+bool onMaxLevel(std::size_t i) {
+    int level = 0;
+    for (std::size_t n = i + 1; n > 1; n /= 2)
+        level++;
+    return level % 2 == 0;
+}
+
+
+
+// check everything about the queue against the reference, a map of every queued job's name to its priority:
+// the max-min order of the keys, the position table, the name index, both ends, and the full listing
+void checkQueue(const BoundedQueue &jobs, const std::map<std::string, int> &reference, int seed, int step) {
+    check(jobs.size() == static_cast<int>(reference.size()), "size differs from the reference", seed, step);
+    check(jobs.size() <= jobs.capacity, "more jobs than the capacity", seed, step);
+
+    // a key on a max level is at least as high as its children and grandchildren, one on a min level at most as
+    // high. the levels below those follow by induction, so this is the whole invariant
+    std::size_t n = jobs.heap.size();
+    for (std::size_t i = 0; i < n; i++) {
+        bool max = onMaxLevel(i);
+        for (std::size_t d = 2 * i + 1; d < n && d <= 2 * i + 2; d++) {
+            for (std::size_t j : {d, 2 * d + 1, 2 * d + 2}) {
+                if (j >= n)
+                    continue;
+                int above = jobs.heap[i].priority;
+                int below = jobs.heap[j].priority;
+                check(max ? above >= below : above <= below, "max-min order broken at index " + std::to_string(i),
+                      seed, step);
+            }
+        }
+
+        JobId id = jobs.heap[i].id;
+        std::string name(jobName(jobs, jobs.heap[i]));
+        check(jobs.positions[id] == static_cast<int>(i), "position table out of date for " + name, seed, step);
+        check(jobs.jobIds.find(name) == id, "name index out of date for " + name, seed, step);
+        auto queued = reference.find(name);
+        check(queued != reference.end() && queued->second == jobs.heap[i].priority,
+              "job " + name + " doesn't match the reference", seed, step);
+    }
+
+    std::vector<int> priorities;
+    for (const auto &[name, priority] : reference)
+        priorities.push_back(priority);
+    std::sort(priorities.begin(), priorities.end(), std::greater<>());
+
+    PrintJob highest;
+    PrintJob lowest;
+    if (priorities.empty()) {
+        check(!peekJob(jobs, highest) && !peekLowestJob(jobs, lowest), "peek on an empty queue", seed, step);
+        return;
+    }
+    check(peekJob(jobs, highest) && highest.priority == priorities.front(), "wrong highest job", seed, step);
+    check(peekLowestJob(jobs, lowest) && lowest.priority == priorities.back(), "wrong lowest job", seed, step);
+
+    std::vector<HeapKey> listed = topK(jobs, jobs.size());
+    bool same = listed.size() == priorities.size();
+    for (std::size_t i = 0; same && i < listed.size(); i++)
+        same = listed[i].priority == priorities[i];
+    check(same, "listing isn't in priority order", seed, step);
+}
+
+
+
+// one run of random operations on a queue of 'capacity' jobs. names come from a small pool and priorities from
+// a small range, so duplicates, ties, evictions and refused jobs all happen often
+void run(int seed, int capacity, int steps) {
+    std::mt19937 rng(seed);
+    BoundedQueue jobs(capacity);
+    std::map<std::string, int> reference;
+    int names = capacity * 2 + 4;
+
+    // helper for checking a job that left the queue against the reference, and taking it out of there
+    auto left = [&](const PrintJob &job, int expected, const char *how, int step) {
+        auto queued = reference.find(job.name);
+        check(queued != reference.end() && queued->second == job.priority && job.priority == expected,
+              std::string(how) + " the wrong job: " + job.name, seed, step);
+        if (queued != reference.end())
+            reference.erase(queued);
+    };
+
+    for (int step = 0; step < steps; step++) {
+        std::string name = "job" + std::to_string(rng() % names);
+        int priority = static_cast<int>(rng() % 20);
+        // the ends of the queue before this step
+        int lowest = reference.empty() ? 0 : reference.begin()->second;
+        int highest = lowest;
+        for (const auto &entry : reference) {
+            lowest = std::min(lowest, entry.second);
+            highest = std::max(highest, entry.second);
+        }
+
+        PrintJob job;
+        switch (rng() % 6) {
+            case 0:
+            case 1: {
+                OfferResult result = offerJob(jobs, name, priority, job);
+                if (reference.count(name)) {
+                    check(result == OfferResult::Duplicate, "duplicate " + name + " not refused", seed, step);
+                } else if (static_cast<int>(reference.size()) < capacity) {
+                    check(result == OfferResult::Added, "job " + name + " not added", seed, step);
+                    reference[name] = priority;
+                } else if (priority <= lowest) {
+                    check(result == OfferResult::TooLow, "job " + name + " not refused as too low", seed, step);
+                } else {
+                    check(result == OfferResult::Evicted, "job " + name + " not added with an eviction", seed, step);
+                    left(job, lowest, "evicted", step);
+                    reference[name] = priority;
+                }
+                break;
+            }
+            case 2: {
+                bool popped = popJob(jobs, job);
+                check(popped == !reference.empty(), "pop doesn't match the reference", seed, step);
+                if (popped)
+                    left(job, highest, "popped", step);
+                break;
+            }
+            case 3: {
+                bool popped = popLowestJob(jobs, job);
+                check(popped == !reference.empty(), "pop of the lowest doesn't match the reference", seed, step);
+                if (popped)
+                    left(job, lowest, "popped as lowest", step);
+                break;
+            }
+            case 4: {
+                bool changed = changePriority(jobs, name, priority);
+                check(changed == (reference.count(name) > 0), "update of " + name + " doesn't match", seed, step);
+                if (changed)
+                    reference[name] = priority;
+                break;
+            }
+            case 5: {
+                bool removed = removeJob(jobs, name);
+                check(removed == (reference.count(name) > 0), "removal of " + name + " doesn't match", seed, step);
+                reference.erase(name);
+                break;
+            }
+        }
+        checkQueue(jobs, reference, seed, step);
+    }
+}
+
+
+
+int main() {
+    // capacities around the first few level boundaries, where the max-min cases differ the most
+    int seed = 0;
+    for (int capacity : {1, 2, 3, 4, 5, 6, 7, 8, 15, 16, 31, 64, 100}) {
+        for (int round = 0; round < 20; round++)
+            run(++seed, capacity, 2000);
+    }
+
+    if (failures > 0) {
+        std::cerr << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "bounded queue: " << seed << " random runs match the reference" << std::endl;
+    return 0;
+}
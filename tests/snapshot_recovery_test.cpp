@@ -0,0 +1,225 @@
+#include <iostream>                     // recovery from snapshots and the job log, at every point a crash can hit
+#include <cstdint>   // for INT32_MAX
+#include <cstdlib>   // for mkdtemp
+#include <filesystem>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "job_log.h"
+#include "print_queue.h"
+#include "snapshot.h"
+
+
+
+// number of failed checks so far
+int failures = 0;
+
+void check(bool ok, const std::string &what) {
+    if (ok)
+        return;
+    std::cerr << what << std::endl;
+    failures++;
+}
+
+
+
+// rebuild a queue from the log at 'path' and its snapshot, the way the program does at startup (see main.cpp):
+// from the snapshot and the changes logged after it if there is one, otherwise from the whole log
+bool recover(const std::string &path, PrintQueue &jobs) {
+    std::string snapshot = path + ".snapshot";
+    if (std::filesystem::exists(snapshot)) {
+        std::uint32_t generation;
+        std::vector<LogChange> changes;
+        if (!loadSnapshot(jobs, snapshot, generation) || !readJobLogTail(path, generation, changes))
+            return false;
+        applyLogChanges(jobs, changes);
+        return true;
+    }
+
+    std::vector<PrintJob> recovered;
+    if (!readJobLog(path, recovered))
+        return false;
+    insertBatch(jobs, recovered);
+    return true;
+}
+
+
+
+// the queue everything is done on, its log, and a map of every queued job's name to its priority to compare with
+struct Session {
+    std::string path;
+    PrintQueue jobs;
+    JobLog log;
+    std::map<std::string, int> expected;
+    std::mt19937 rng;
+
+    Session(const std::string &path, int seed) : path(path), rng(seed) { log.open(path); }
+
+    // random inserts, pops, updates and cancels, each logged the way the program logs it
+    void change(int count) {
+        for (int i = 0; i < count; i++) {
+            std::string name = "job" + std::to_string(rng() % 200);
+            int priority = static_cast<int>(rng() % 1000);
+            PrintJob job;
+            switch (rng() % 4) {
+                case 0:
+                    if (pushJob(jobs, name, priority)) {
+                        log.append(LogOp::Insert, name, priority);
+                        expected[name] = priority;
+                    }
+                    break;
+                case 1:
+                    if (popJob(jobs, job)) {
+                        log.append(LogOp::Pop, job.name, job.priority);
+                        expected.erase(job.name);
+                    }
+                    break;
+                case 2:
+                    if (changePriority(jobs, name, priority)) {
+                        log.append(LogOp::Update, name, priority);
+                        expected[name] = priority;
+                    }
+                    break;
+                case 3:
+                    if (removeJob(jobs, name)) {
+                        log.append(LogOp::Cancel, name, 0);
+                        expected.erase(name);
+                    }
+                    break;
+            }
+        }
+        log.commit(log.appendCount());
+    }
+
+    // save the queue as the snapshot last marked in the log
+    bool snapshot() { return saveSnapshot(jobs, path + ".snapshot", log.snapshotGeneration()); }
+};
+
+
+
+// a copy of the files as a crash at some point would have left them, and what recovering from them should give
+struct CrashPoint {
+    std::string name;
+    std::string path;
+    std::map<std::string, int> expected;
+    bool recoverable;
+};
+
+// helper for copying the log and its snapshot (if there is one) to a directory of their own
+CrashPoint capture(const std::string &directory, const std::string &name, const Session &session, bool recoverable = true) {
+    std::string copy = directory + "/" + name;
+    std::filesystem::create_directory(copy);
+    std::string path = copy + "/queue.log";
+    std::filesystem::copy_file(session.path, path);
+    if (std::filesystem::exists(session.path + ".snapshot"))
+        std::filesystem::copy_file(session.path + ".snapshot", path + ".snapshot");
+    return {name, path, session.expected, recoverable};
+}
+
+
+
+// recover from a crash point, and check the queue against what it should be, in priority order
+void checkRecovery(const CrashPoint &point, int seed) {
+    std::string where = "seed " + std::to_string(seed) + ", " + point.name + ": ";
+    PrintQueue jobs;
+    bool recovered = recover(point.path, jobs);
+    if (!point.recoverable) {
+        check(!recovered, where + "files that don't go together were recovered");
+        return;
+    }
+    check(recovered, where + "recovery failed");
+
+    std::map<std::string, int> queued;
+    PrintJob job;
+    int last = INT32_MAX;
+    while (popJob(jobs, job)) {
+        check(job.priority <= last, where + "jobs don't come out in priority order");
+        last = job.priority;
+        check(queued.emplace(job.name, job.priority).second, where + "job " + job.name + " recovered twice");
+    }
+    check(queued == point.expected, where + "recovered jobs differ from the ones that were queued");
+
+    // the log has to take new records after the recovery
+    JobLog log;
+    check(log.open(point.path), where + "the log can't be reopened");
+}
+
+
+
+// go through snapshots the way the program takes them, and keep the files at every point in between
+void run(const std::string &directory, int seed) {
+    Session session(directory + "/queue.log", seed);
+    std::vector<CrashPoint> points;
+
+    session.change(300);
+    points.push_back(capture(directory, "no snapshot yet", session));
+
+    // a first snapshot, all the way through
+    session.log.markSnapshot();
+    session.snapshot();
+    session.log.restart();
+    session.change(300);
+    points.push_back(capture(directory, "tail after the first snapshot", session));
+
+    // the marker of the second snapshot was only partly written when the program died
+    session.log.markSnapshot();
+    CrashPoint torn = capture(directory, "torn marker", session);
+    std::filesystem::resize_file(torn.path, std::filesystem::file_size(torn.path) - 5);
+    points.push_back(torn);
+    points.push_back(capture(directory, "marked, not saved", session));
+
+    // saving the second snapshot failed, and the program went on. the snapshot on disk is older than the
+    // last marker in the log now
+    session.change(200);
+    CrashPoint stale = capture(directory, "stale snapshot", session);
+    points.push_back(stale);
+
+    // the third snapshot is saved, but the log wasn't started over yet
+    session.log.markSnapshot();
+    session.snapshot();
+    points.push_back(capture(directory, "saved, log not restarted", session));
+
+    session.log.restart();
+    points.push_back(capture(directory, "log restarted", session));
+    session.change(300);
+    points.push_back(capture(directory, "tail after the third snapshot", session));
+
+    // a log that was started over is useless without its snapshot, or with an older one
+    CrashPoint missing = capture(directory, "snapshot missing", session, false);
+    std::filesystem::remove(missing.path + ".snapshot");
+    points.push_back(missing);
+    CrashPoint older = capture(directory, "older snapshot", session, false);
+    std::filesystem::copy_file(stale.path + ".snapshot", older.path + ".snapshot",
+                               std::filesystem::copy_options::overwrite_existing);
+    points.push_back(older);
+
+    for (const auto &point : points)
+        checkRecovery(point, seed);
+}
+
+
+
+int main() {
+    std::string base = (std::filesystem::temp_directory_path() / "maxheap_snapshot_test.XXXXXX").string();
+    if (::mkdtemp(base.data()) == nullptr) {
+        std::cerr << "Error: Can't create a directory for the test." << std::endl;
+        return 1;
+    }
+
+    constexpr int SEEDS = 20;
+    for (int seed = 1; seed <= SEEDS; seed++) {
+        std::string directory = base + "/" + std::to_string(seed);
+        std::filesystem::create_directory(directory);
+        run(directory, seed);
+    }
+    std::filesystem::remove_all(base);
+
+    if (failures > 0) {
+        std::cerr << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "snapshot recovery: every crash point of " << SEEDS << " runs recovers the queued jobs" << std::endl;
+    return 0;
+}
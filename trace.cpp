@@ -0,0 +1,149 @@
+#include "trace.h"
+
+#include <cerrno>
+#include <cstring>       // for std::memcpy, std::memcmp
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+
+// first bytes of every trace file
+static constexpr char TRACE_MAGIC[8] = {'M', 'H', 'T', 'R', 'A', 'C', 'E', '1'};
+
+// bytes of a record before the name: time, op, value, name length
+static constexpr std::size_t RECORD_HEADER = 8 + 1 + 4 + 4;
+
+
+
+// helper for writing a whole buffer, however many write calls that takes
+static bool writeAll(int fd, const char *data, std::size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+
+
+TraceRecorder::~TraceRecorder() {
+    close();
+}
+
+
+
+bool TraceRecorder::open(const std::string &path) {
+    close();
+
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return false;
+
+    failed = false;
+    buffer.clear();
+    buffer.reserve(BUFFER_SIZE);
+    buffer.resize(sizeof(TRACE_MAGIC));
+    std::memcpy(buffer.data(), TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    start = std::chrono::steady_clock::now();
+    return true;
+}
+
+
+
+bool TraceRecorder::close() {
+    if (fd < 0)
+        return true;
+
+    flush();
+    ::close(fd);
+    fd = -1;
+    return !failed;
+}
+
+
+
+void TraceRecorder::append(TraceOp op, std::string_view name, int value) {
+    if (buffer.size() + RECORD_HEADER + name.size() > BUFFER_SIZE)
+        flush();
+
+    std::uint64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    std::uint32_t length = static_cast<std::uint32_t>(name.size());
+
+    std::size_t pos = buffer.size();
+    buffer.resize(pos + RECORD_HEADER + length);
+    char *record = buffer.data() + pos;
+    std::memcpy(record, &time, 8);
+    record[8] = static_cast<char>(op);
+    std::memcpy(record + 9, &value, 4);
+    std::memcpy(record + 13, &length, 4);
+    std::memcpy(record + RECORD_HEADER, name.data(), length);
+}
+
+
+
+bool TraceRecorder::flush() {
+    if (!buffer.empty() && !writeAll(fd, buffer.data(), buffer.size()))
+        failed = true;
+    buffer.clear();
+    return !failed;
+}
+
+
+
+bool readTrace(const std::string &path, std::vector<TraceEvent> &events) {
+    events.clear();
+
+    int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file < 0)
+        return false;
+
+    // the whole trace is read at once, it is parsed from memory
+    struct stat info {};
+    if (::fstat(file, &info) != 0) {
+        ::close(file);
+        return false;
+    }
+    std::vector<char> data(static_cast<std::size_t>(info.st_size));
+    std::size_t filled = 0;
+    while (filled < data.size()) {
+        ssize_t got = ::read(file, data.data() + filled, data.size() - filled);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got < 0) {
+            ::close(file);
+            return false;
+        }
+        if (got == 0)
+            break;
+        filled += static_cast<std::size_t>(got);
+    }
+    ::close(file);
+    data.resize(filled);
+
+    if (data.size() < sizeof(TRACE_MAGIC) || std::memcmp(data.data(), TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0)
+        return false;
+
+    std::size_t pos = sizeof(TRACE_MAGIC);
+    while (data.size() - pos >= RECORD_HEADER) {
+        const char *record = data.data() + pos;
+        std::uint32_t length;
+        std::memcpy(&length, record + 13, 4);
+        if (length > data.size() - pos - RECORD_HEADER)
+            break;
+
+        TraceEvent &event = events.emplace_back();
+        std::memcpy(&event.time, record, 8);
+        event.op = static_cast<TraceOp>(record[8]);
+        std::memcpy(&event.value, record + 9, 4);
+        event.name.assign(record + RECORD_HEADER, length);
+        pos += RECORD_HEADER + length;
+    }
+    return true;
+}
@@ -0,0 +1,87 @@
+#ifndef MAXHEAP_TRACE_H
+#define MAXHEAP_TRACE_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+
+// kinds of operations recorded in a trace
+enum class TraceOp : std::uint8_t {
+    Insert = 1,
+    Pop = 2,
+    Update = 3,
+    Cancel = 4,
+    Display = 5,
+};
+
+
+
+// one operation from a trace
+struct TraceEvent {
+    // nanoseconds from the start of the recording until the operation was asked for
+    std::uint64_t time = 0;
+    TraceOp op = TraceOp::Pop;
+
+    // the priority for Insert and Update, the number of jobs shown for Display (-1 for all of them)
+    int value = 0;
+
+    // the job's name for Insert, Update and Cancel
+    std::string name;
+};
+
+
+
+// records the operations asked of the queue, so a workload can be replayed later (see replay.cpp).
+// unlike the job log, a trace records what was asked, whether it succeeded or not, and isn't meant to survive
+// a crash: records are collected in a buffer and written out when it is full or when the recorder is closed.
+//
+// the file starts with a short magic header, followed by one record per operation:
+//   u64 time, u8 op, i32 value, u32 name length, name bytes
+// in native byte order
+class TraceRecorder {
+public:
+    // bytes collected before they are written out
+    static constexpr std::size_t BUFFER_SIZE = 64 * 1024;
+
+    TraceRecorder() = default;
+    ~TraceRecorder();
+
+    TraceRecorder(const TraceRecorder &) = delete;
+    TraceRecorder &operator=(const TraceRecorder &) = delete;
+
+    // start a new trace at 'path', replacing any file there. times are counted from here.
+    // returns false if the file can't be created
+    bool open(const std::string &path);
+
+    // write out what is left and close the file. returns false if any write failed
+    bool close();
+
+    bool isOpen() const { return fd >= 0; }
+
+    // record an operation. does nothing if no trace is open
+    void record(TraceOp op, std::string_view name = {}, int value = 0) {
+        if (fd >= 0)
+            append(op, name, value);
+    }
+
+private:
+    void append(TraceOp op, std::string_view name, int value);
+    bool flush();
+
+    int fd = -1;
+    std::vector<char> buffer;
+    std::chrono::steady_clock::time_point start;
+    bool failed = false;
+};
+
+
+
+// read the whole trace at 'path' into 'events'. a record that was cut off at the end is left out.
+// returns false if the file can't be read or isn't a trace
+bool readTrace(const std::string &path, std::vector<TraceEvent> &events);
+
+#endif // MAXHEAP_TRACE_H